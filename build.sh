@@ -0,0 +1,16 @@
+#!/bin/sh
+# NOTE: builds the headless simulation, the game itself is built with build_windows.bat or build_wasm.bat
+
+mkdir -p build
+cd build
+
+compiler_flags="-std=c++14 -Wall -Wno-missing-braces -Wno-unused-function -Wno-unused-variable -Wno-unused-but-set-variable -Wno-sign-compare -Wno-switch"
+
+if [ "$1" = "release" ]; then
+    compiler_flags="-O2 -DBUILD_DEBUG=0 $compiler_flags"
+else
+    compiler_flags="-O0 -g -DBUILD_DEBUG=1 -DDEVELOPER=1 $compiler_flags"
+fi
+
+g++ $compiler_flags ../code/headless.cpp -o headless -lm || exit 1
+cp headless ../run_tree/headless
@@ -1,49 +1,446 @@
+// NOTE(Alexander): the immediate mode part of rlgl (raylib 5.0), raylib.h doesn't declare
+// these but they are exported by the library. Used to submit many quads/ lines as one batch.
+#define RL_LINES 0x0001
+#define RL_QUADS 0x0007
 
+extern "C" {
+    RLAPI void rlBegin(int mode);
+    RLAPI void rlEnd(void);
+    RLAPI void rlVertex2f(float x, float y);
+    RLAPI void rlTexCoord2f(float x, float y);
+    RLAPI void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+    RLAPI void rlSetTexture(unsigned int id);
+    RLAPI bool rlCheckRenderBatchLimit(int vertex_count);
+}
+
+
+inline Rectangle
+get_tile_src(Game_State* game, Tile tile) {
+    int tile_xcount = (int) (game->texture_tiles.width/game->meters_to_pixels);
+    assert(tile_xcount);
+    
+    int tile_index = get_tile_gid(tile) - 1;
+    Rectangle src = { 0, 0, game->meters_to_pixels, game->meters_to_pixels };
+    src.x = (f32) (tile_index % tile_xcount) * game->meters_to_pixels;
+    src.y = (f32) (tile_index / tile_xcount) * game->meters_to_pixels;
+    return src;
+}
+
+// NOTE(Alexander): applies the Tiled flip flags, raylib mirrors the source for negative sizes.
+// A diagonal flip swaps the axes which is the same as rotating 90 degrees clockwise
+// after mirroring, so the horizontal and vertical flips trade places.
 void
-draw_tilemap(Game_State* game) {
+draw_tile(Game_State* game, Tile tile, Rectangle dest) {
+    Rectangle src = get_tile_src(game, tile);
     Vector2 origin = {};
+    f32 rotation = 0.0f;
     
-    v2s screen_p;
-    screen_p.x = (s32) floor(game->camera_p.x);
-    screen_p.y = (s32) floor(game->camera_p.y);
+    bool flip_x = (tile & TILE_FLIP_HORIZONTAL) != 0;
+    bool flip_y = (tile & TILE_FLIP_VERTICAL) != 0;
+    if (tile & TILE_FLIP_DIAGONAL) {
+        bool was_flip_x = flip_x;
+        flip_x = flip_y;
+        flip_y = !was_flip_x;
+        rotation = 90.0f;
+        
+        // Rotate around the center of the tile
+        origin.x = dest.width/2.0f;
+        origin.y = dest.height/2.0f;
+        dest.x += origin.x;
+        dest.y += origin.y;
+    }
     
-    int tile_xcount = (int) (game->texture_tiles.width/game->meters_to_pixels);
-    assert(tile_xcount);
-    for (int y = 0; y < game->tile_map_height; y++) {
-        for (int x = 0; x < game->tile_map_width; x++) {
+    if (flip_x) src.width = -src.width;
+    if (flip_y) src.height = -src.height;
+    DrawTexturePro(game->texture_tiles, src, dest, origin, rotation, WHITE);
+}
+
+void
+render_tile_chunk(Game_State* game, Tile_Chunk* chunk) {
+    if (chunk->target.id == 0) {
+        chunk->target = LoadRenderTexture((int) (TILE_CHUNK_WIDTH*game->meters_to_pixels),
+                                          (int) (TILE_CHUNK_HEIGHT*game->meters_to_pixels));
+        SetTextureFilter(chunk->target.texture, TEXTURE_FILTER_POINT);
+    }
+    
+    int min_x = chunk->chunk_x*TILE_CHUNK_WIDTH;
+    int min_y = chunk->chunk_y*TILE_CHUNK_HEIGHT;
+    int max_x = min(min_x + TILE_CHUNK_WIDTH, game->tile_map_width);
+    int max_y = min(min_y + TILE_CHUNK_HEIGHT, game->tile_map_height);
+    
+    BeginTextureMode(chunk->target);
+    ClearBackground(BLANK);
+    for (int y = min_y; y < max_y; y++) {
+        for (int x = min_x; x < max_x; x++) {
+            Tile tile = game->tile_map[y*game->tile_map_width + x];
+            if (tile == 0) continue;
             
-            if (x >= screen_p.x && x <= screen_p.x + game->game_width) {
-                
-                u8 tile = game->tile_map[y*game->tile_map_width + x];
-                if (tile == 0) continue;
-                tile--;
-                
-                Rectangle src = { 0, 0, game->meters_to_pixels, game->meters_to_pixels };
-                src.x = (tile % tile_xcount) * game->meters_to_pixels;
-                src.y = (tile / tile_xcount) * game->meters_to_pixels;
+            Rectangle dest = { 0, 0, game->meters_to_pixels, game->meters_to_pixels };
+            dest.x = (x - min_x) * game->meters_to_pixels;
+            dest.y = (y - min_y) * game->meters_to_pixels;
+            draw_tile(game, tile, dest);
+        }
+    }
+    EndTextureMode();
+    
+    chunk->is_dirty = false;
+}
+
+struct Tile_Range {
+    int min_x, min_y;
+    int max_x, max_y; // inclusive
+};
+
+// NOTE(Alexander): only the tiles inside the camera are visited, so the cost of
+// drawing the tile map depends on the screen size and not the level size.
+inline Tile_Range
+get_visible_tile_range(Game_State* game) {
+    int camera_x = (int) floorf(game->camera_p.x);
+    int camera_y = (int) floorf(game->camera_p.y);
+    
+    Tile_Range result;
+    result.min_x = max(camera_x, 0);
+    result.min_y = max(camera_y, 0);
+    result.max_x = min(camera_x + game->game_width, game->tile_map_width - 1);
+    result.max_y = min(camera_y + game->game_height, game->tile_map_height - 1);
+    return result;
+}
+
+inline Tile_Range
+get_visible_tile_chunks(Game_State* game) {
+    Tile_Range result = get_visible_tile_range(game);
+    if (result.min_x > result.max_x || result.min_y > result.max_y) {
+        result = {0, 0, -1, -1};
+        return result;
+    }
+    
+    result.min_x /= TILE_CHUNK_WIDTH;
+    result.min_y /= TILE_CHUNK_HEIGHT;
+    result.max_x /= TILE_CHUNK_WIDTH;
+    result.max_y /= TILE_CHUNK_HEIGHT;
+    return result;
+}
+
+Tile_Chunk*
+find_tile_chunk(Game_State* game, int chunk_x, int chunk_y) {
+    for_array(game->tile_chunks, chunk, _) {
+        if (chunk->is_used && chunk->chunk_x == chunk_x && chunk->chunk_y == chunk_y) {
+            return chunk;
+        }
+    }
+    return 0;
+}
+
+// NOTE(Alexander): has to be called outside of BeginTextureMode, raylib can't nest render targets
+void
+update_tile_chunks(Game_State* game) {
+    game->tile_chunk_frame++;
+    
+    Tile_Range range = get_visible_tile_chunks(game);
+    for (int chunk_y = range.min_y; chunk_y <= range.max_y; chunk_y++) {
+        for (int chunk_x = range.min_x; chunk_x <= range.max_x; chunk_x++) {
+            Tile_Chunk* chunk = find_tile_chunk(game, chunk_x, chunk_y);
+            if (!chunk) {
+                // Reuse the least recently drawn chunk
+                chunk = &game->tile_chunks[0];
+                for_array(game->tile_chunks, it, _) {
+                    if (!it->is_used) {
+                        chunk = it;
+                        break;
+                    }
+                    if (it->last_used_frame < chunk->last_used_frame) {
+                        chunk = it;
+                    }
+                }
                 
-                Rectangle dest = { 0, 0, game->meters_to_pixels, game->meters_to_pixels };
-                dest.x = floorf((x - game->camera_p.x) * game->meters_to_pixels);
-                dest.y = floorf((y - game->camera_p.y) * game->meters_to_pixels);
-                DrawTexturePro(game->texture_tiles, src, dest, origin, 0.0f, WHITE);
+                chunk->chunk_x = chunk_x;
+                chunk->chunk_y = chunk_y;
+                chunk->is_used = true;
+                chunk->is_dirty = true;
             }
+            
+            if (chunk->is_dirty) {
+                render_tile_chunk(game, chunk);
+            }
+            chunk->last_used_frame = game->tile_chunk_frame;
+        }
+    }
+}
+
+inline void
+invalidate_tile_chunks(Game_State* game) {
+    for_array(game->tile_chunks, chunk, _) {
+        chunk->is_used = false;
+    }
+}
+
+void
+draw_tile_range(Game_State* game) {
+    Tile_Range range = get_visible_tile_range(game);
+    for (int y = range.min_y; y <= range.max_y; y++) {
+        for (int x = range.min_x; x <= range.max_x; x++) {
+            Tile tile = game->tile_map[y*game->tile_map_width + x];
+            if (tile == 0) continue;
+            
+            Rectangle dest = { 0, 0, game->meters_to_pixels, game->meters_to_pixels };
+            dest.x = floorf((x - game->camera_p.x) * game->meters_to_pixels);
+            dest.y = floorf((y - game->camera_p.y) * game->meters_to_pixels);
+            draw_tile(game, tile, dest);
+        }
+    }
+}
+
+void
+draw_tile_chunks(Game_State* game) {
+    Vector2 origin = {};
+    
+    Tile_Range range = get_visible_tile_chunks(game);
+    for (int chunk_y = range.min_y; chunk_y <= range.max_y; chunk_y++) {
+        for (int chunk_x = range.min_x; chunk_x <= range.max_x; chunk_x++) {
+            Tile_Chunk* chunk = find_tile_chunk(game, chunk_x, chunk_y);
+            if (!chunk || chunk->is_dirty) continue;
+            
+            // NOTE(Alexander): render textures are stored upside down
+            Texture2D texture = chunk->target.texture;
+            Rectangle src = { 0, 0, (f32) texture.width, (f32) -texture.height };
+            Rectangle dest = { 0, 0, (f32) texture.width, (f32) texture.height };
+            dest.x = floorf((chunk_x*TILE_CHUNK_WIDTH - game->camera_p.x) * game->meters_to_pixels);
+            dest.y = floorf((chunk_y*TILE_CHUNK_HEIGHT - game->camera_p.y) * game->meters_to_pixels);
+            DrawTexturePro(texture, src, dest, origin, 0.0f, WHITE);
+        }
+    }
+}
+
+inline void
+draw_tilemap(Game_State* game) {
+#if CACHE_TILE_CHUNKS
+    draw_tile_chunks(game);
+#else
+    draw_tile_range(game);
+#endif
+}
+
+#define SPRITE_ATLAS_WIDTH 256
+#define SPRITE_ATLAS_PADDING 2
+
+struct Sprite_Source {
+    Sprite* sprite;
+    cstring filename;
+    bool is_packed;
+    Image image;
+    Sprite_Source* duplicate_of;
+};
+
+// NOTE(Alexander): packs all the sprites into one atlas texture so entities and
+// the ui can be drawn without switching textures, uses simple shelf packing with
+// the tallest images first.
+void
+load_sprites(Game_State* game) {
+    Sprite_Source sources[] = {
+#define SPRITE(name, filename, packed) { &game->sprite_##name, "assets/" filename, packed },
+        DEF_SPRITE
+#undef SPRITE
+    };
+    
+    Sprite_Source* packed[fixed_array_count(sources)];
+    int packed_count = 0;
+    for (int source_index = 0; source_index < fixed_array_count(sources); source_index++) {
+        Sprite_Source* source = &sources[source_index];
+        if (!source->is_packed) {
+            source->sprite->texture = LoadTexture(source->filename);
+            source->sprite->region = { 0, 0, (f32) source->sprite->texture.width, (f32) source->sprite->texture.height };
+            continue;
+        }
+        
+        for (int packed_index = 0; packed_index < packed_count; packed_index++) {
+            if (strcmp(packed[packed_index]->filename, source->filename) == 0) {
+                source->duplicate_of = packed[packed_index];
+                break;
+            }
+        }
+        if (source->duplicate_of) continue;
+        
+        source->image = LoadImage(source->filename);
+        int insert_index = packed_count++;
+        while (insert_index > 0 && packed[insert_index - 1]->image.height < source->image.height) {
+            packed[insert_index] = packed[insert_index - 1];
+            insert_index--;
+        }
+        packed[insert_index] = source;
+    }
+    
+    int x = 0;
+    int y = 0;
+    int row_height = 0;
+    for (int packed_index = 0; packed_index < packed_count; packed_index++) {
+        Sprite_Source* source = packed[packed_index];
+        if (x + source->image.width > SPRITE_ATLAS_WIDTH) {
+            x = 0;
+            y += row_height + SPRITE_ATLAS_PADDING;
+            row_height = 0;
+        }
+        
+        source->sprite->region = { (f32) x, (f32) y, (f32) source->image.width, (f32) source->image.height };
+        x += source->image.width + SPRITE_ATLAS_PADDING;
+        row_height = max(row_height, source->image.height);
+    }
+    
+    Image atlas = GenImageColor(SPRITE_ATLAS_WIDTH, max(y + row_height, 1), BLANK);
+    for (int packed_index = 0; packed_index < packed_count; packed_index++) {
+        Sprite_Source* source = packed[packed_index];
+        Rectangle src = { 0, 0, (f32) source->image.width, (f32) source->image.height };
+        ImageDraw(&atlas, source->image, src, source->sprite->region, WHITE);
+        UnloadImage(source->image);
+    }
+    game->texture_atlas = LoadTextureFromImage(atlas);
+    UnloadImage(atlas);
+    
+    for (int source_index = 0; source_index < fixed_array_count(sources); source_index++) {
+        Sprite_Source* source = &sources[source_index];
+        if (source->duplicate_of) {
+            source->sprite->region = source->duplicate_of->sprite->region;
+        }
+        if (source->is_packed) {
+            source->sprite->texture = game->texture_atlas;
         }
     }
 }
 
 int
-get_frame_index(Entity* entity) {
-    int frame = (int) entity->frame_advance;
+get_frame_index(Entity_Render* render) {
+    int frame = (int) render->frame_advance;
     return frame;
 }
 
 void
-draw_sprite(Game_State* game, Texture2D* sprite, v2 p, v2 sprite_offset, v2 size, v2 dir, int frame=0) {
+begin_sprite_batch(Game_State* game, int max_count) {
+    Sprite_Batch* batch = &game->sprite_batch;
+    assert(!batch->quads && "sprite batch is already started");
+    batch->quads = push_frame_array(game, max_count, Sprite_Quad);
+    batch->max_count = max_count;
+    batch->count = 0;
+}
+
+void
+flush_sprite_batch(Game_State* game) {
+    Sprite_Batch* batch = &game->sprite_batch;
+    if (batch->count == 0) return;
+    
+    // NOTE(Alexander): stable merge sort by texture, sprites sharing a texture
+    // keep the order they were pushed in.
+    Temp_Memory temp_memory = begin_temporary_memory(&game->frame_arena);
+    Sprite_Quad* src = batch->quads;
+    Sprite_Quad* dest = push_frame_array(game, batch->count, Sprite_Quad);
+    for (int width = 1; width < batch->count; width *= 2) {
+        for (int start = 0; start < batch->count; start += 2*width) {
+            int mid = min(start + width, batch->count);
+            int end = min(start + 2*width, batch->count);
+            int left = start;
+            int right = mid;
+            for (int index = start; index < end; index++) {
+                if (left < mid && (right >= end || src[left].texture.id <= src[right].texture.id)) {
+                    dest[index] = src[left++];
+                } else {
+                    dest[index] = src[right++];
+                }
+            }
+        }
+        
+        Sprite_Quad* swap = src;
+        src = dest;
+        dest = swap;
+    }
+    
+    // NOTE(Alexander): one rlBegin per run of quads sharing a texture, the texture coordinates
+    // follow DrawTexturePro where a negative source size mirrors the sprite.
+    for (int run_start = 0; run_start < batch->count;) {
+        Texture2D texture = src[run_start].texture;
+        int run_end = run_start + 1;
+        while (run_end < batch->count && src[run_end].texture.id == texture.id) {
+            run_end++;
+        }
+        
+        if (texture.id > 0) {
+            f32 inv_width = 1.0f / (f32) texture.width;
+            f32 inv_height = 1.0f / (f32) texture.height;
+            
+            rlSetTexture(texture.id);
+            rlBegin(RL_QUADS);
+            rlColor4ub(255, 255, 255, 255);
+            for (int quad_index = run_start; quad_index < run_end; quad_index++) {
+                Sprite_Quad* quad = &src[quad_index];
+                
+                f32 u0 = quad->src.x;
+                f32 u1 = quad->src.x + quad->src.width;
+                if (quad->src.width < 0) {
+                    u0 = quad->src.x - quad->src.width;
+                    u1 = quad->src.x;
+                }
+                f32 v0 = quad->src.y;
+                f32 v1 = quad->src.y + quad->src.height;
+                if (quad->src.height < 0) {
+                    v0 = quad->src.y - quad->src.height;
+                    v1 = quad->src.y;
+                }
+                u0 *= inv_width;
+                u1 *= inv_width;
+                v0 *= inv_height;
+                v1 *= inv_height;
+                
+                f32 x0 = quad->dest.x;
+                f32 y0 = quad->dest.y;
+                f32 x1 = quad->dest.x + quad->dest.width;
+                f32 y1 = quad->dest.y + quad->dest.height;
+                
+                rlCheckRenderBatchLimit(4);
+                rlTexCoord2f(u0, v0); rlVertex2f(x0, y0);
+                rlTexCoord2f(u0, v1); rlVertex2f(x0, y1);
+                rlTexCoord2f(u1, v1); rlVertex2f(x1, y1);
+                rlTexCoord2f(u1, v0); rlVertex2f(x1, y0);
+            }
+            rlEnd();
+            rlSetTexture(0);
+        }
+        
+        run_start = run_end;
+    }
+    
+    end_temporary_memory(temp_memory);
+    batch->count = 0;
+}
+
+void
+end_sprite_batch(Game_State* game) {
+    flush_sprite_batch(game);
+    game->sprite_batch.quads = 0;
+}
+
+void
+push_sprite(Game_State* game, Texture2D texture, Rectangle src, Rectangle dest) {
+    Sprite_Batch* batch = &game->sprite_batch;
+    if (!batch->quads) {
+        Vector2 origin = {};
+        DrawTexturePro(texture, src, dest, origin, 0, WHITE);
+        return;
+    }
+    
+    if (batch->count >= batch->max_count) {
+        flush_sprite_batch(game);
+    }
+    
+    Sprite_Quad* quad = &batch->quads[batch->count++];
+    quad->texture = texture;
+    quad->src = src;
+    quad->dest = dest;
+}
+
+void
+draw_sprite(Game_State* game, Sprite* sprite, v2 p, v2 sprite_offset, v2 size, v2 dir, int frame=0) {
     p = to_pixel_v2(game, p);
     sprite_offset = to_pixel_size_v2(game, sprite_offset);
     size = to_pixel_size_v2(game, size);
     
-    Rectangle src = { sprite_offset.x, sprite_offset.y, size.width, size.height };
+    Rectangle src = { sprite->region.x + sprite_offset.x, sprite->region.y + sprite_offset.y, size.width, size.height };
     Rectangle dest = { p.x, p.y, size.width, size.height };
     
     if (frame > 0) {
@@ -57,8 +454,7 @@ draw_sprite(Game_State* game, Texture2D* sprite, v2 p, v2 sprite_offset, v2 size
         src.height = -src.height;
     }
     
-    Vector2 origin = {};
-    DrawTexturePro(*sprite, src, dest, origin, 0, WHITE);
+    push_sprite(game, sprite->texture, src, dest);
 }
 
 #define VINE_COLOR CLITERAL(Color){ 47, 87, 83, 255 }
@@ -66,75 +462,86 @@ draw_sprite(Game_State* game, Texture2D* sprite, v2 p, v2 sprite_offset, v2 size
 void
 draw_entity(Game_State* game, Entity* entity, Entity_Layer layer) {
     if (entity->type == None) return;
-    if (entity->layer != layer) return;
+    Entity_Render* render = get_entity_render(game, entity);
+    if (render->layer != layer) return;
+    Box* collider = get_entity_collider(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
+    // NOTE(Alexander): interpolate between the last two simulation steps
+    v2 render_p = lerp(render->prev_p, collider->p, game->render_alpha);
     
-    int frame = get_frame_index(entity);
+    int frame = get_frame_index(render);
     v2 dir = entity->direction;
-    if (dir.y > 0 && entity->invert_gravity) {
+    if (dir.y > 0 && flags->invert_gravity) {
         dir.y = -1;
     }
-    if (dir.y < 0 && !entity->invert_gravity) {
+    if (dir.y < 0 && !flags->invert_gravity) {
         dir.y = 1;
     }
     
     switch (entity->type) {
         case Vine: {
-            if (entity->size.x > 1.0f) { 
+            if (collider->size.x > 1.0f) { 
                 f32 y_offset = entity->direction.y < 0 ? 0.0f : 1.0f;
-                v2s s = to_pixel(game, entity->p + vec2(entity->offset.x, y_offset));
-                v2s e = to_pixel(game, entity->p + vec2(entity->size.x + entity->offset.x, y_offset));
+                v2s s = to_pixel(game, render_p + vec2(entity->offset.x, y_offset));
+                v2s e = to_pixel(game, render_p + vec2(collider->size.x + entity->offset.x, y_offset));
+                
+                // NOTE(Alexander): lines are drawn immediately, submit the sprites pushed
+                // so far first so the vine still ends up on top of them.
+                flush_sprite_batch(game);
                 DrawLine(s.x, s.y, e.x, e.y, VINE_COLOR);
                 DrawLine(s.x, s.y + 1, e.x, e.y + 1, VINE_COLOR);
             } else {
-                draw_sprite(game, entity->sprite, entity->p + vec2(0.0f, 0.0f), {}, vec2(1.0f, 1.0f), entity->direction);
+                draw_sprite(game, render->sprite, render_p + vec2(0.0f, 0.0f), {}, vec2(1.0f, 1.0f), entity->direction);
             }
         } break;
         
         case Gravity_Inverted:
         case Gravity_Normal: {
             v2 sprite_offset = vec2(1.0f, 1.0f)*game->global_timer*2.0f + game->camera_p.x*0.2f;
-            draw_sprite(game, entity->sprite, entity->p, sprite_offset, entity->size, {}, 0);
+            draw_sprite(game, render->sprite, render_p, sprite_offset, collider->size, {}, 0);
         } break;
         
         case Player: {
             v2 sprite_offset = {};
             sprite_offset.x = 0.2f;
             
-            if (!entity->is_grounded) {
+            if (!flags->is_grounded) {
                 frame = 2;
             }
             
             if (dir.y > 0) {
                 sprite_offset.y = 0.6f;//25f;
-                draw_sprite(game, &game->texture_character, entity->p - sprite_offset, {}, vec2(1.0f, 2.0f), dir, frame);
+                draw_sprite(game, &game->sprite_character, render_p - sprite_offset, {}, vec2(1.0f, 2.0f), dir, frame);
             } else {
                 sprite_offset.y = 0.15f;//25f;
-                draw_sprite(game, &game->texture_character_inv, entity->p - sprite_offset, {}, vec2(1.0f, 2.7f), dir, frame);
+                draw_sprite(game, &game->sprite_character_inv, render_p - sprite_offset, {}, vec2(1.0f, 2.7f), dir, frame);
             }
         } break;
         
         case Enemy_Sharpie: {
             dir = entity->direction;
-            if (dir.y > 0 && entity->invert_gravity &&
-                entity->invert_gravity == entity->prev_invert_gravity) {
+            if (dir.y > 0 && flags->invert_gravity &&
+                flags->invert_gravity == entity->prev_invert_gravity) {
                 dir.y = -1;
             }
-            if (dir.y < 0 && !entity->invert_gravity &&
-                entity->invert_gravity == entity->prev_invert_gravity) {
+            if (dir.y < 0 && !flags->invert_gravity &&
+                flags->invert_gravity == entity->prev_invert_gravity) {
                 dir.y = 1;
             }
             
-            if (entity->sprite) {
-                draw_sprite(game, entity->sprite, entity->p, {}, entity->size, dir, frame);
+            if (render->sprite) {
+                draw_sprite(game, render->sprite, render_p, {}, collider->size, dir, frame);
             }
         } break;
         
         default: {
-            if (entity->sprite) {
-                draw_sprite(game, entity->sprite, entity->p, {}, entity->size, dir, frame);
+            if (render->sprite) {
+                draw_sprite(game, render->sprite, render_p, {}, collider->size, dir, frame);
             } else {
-                v2s p = to_pixel(game, entity->p);
-                v2s size = to_pixel_size(game, entity->size);
+                v2s p = to_pixel(game, render_p);
+                v2s size = to_pixel_size(game, collider->size);
+                flush_sprite_batch(game);
                 DrawRectangle(p.x, p.y, size.width, size.height, RED);
             }
         }
@@ -142,40 +549,49 @@ draw_entity(Game_State* game, Entity* entity, Entity_Layer layer) {
     
 }
 
+inline void
+draw_ui_sprite(Sprite* sprite, Vector2 p, f32 scale) {
+    Rectangle dest = { p.x, p.y, sprite->region.width*scale, sprite->region.height*scale };
+    Vector2 origin = {};
+    DrawTexturePro(sprite->texture, sprite->region, dest, origin, 0, WHITE);
+}
+
 void
 game_draw_ui(Game_State* game, f32 width, f32 height, f32 scale) {
     
     if (game->mode == GameMode_Level) {
-        cstring coins = TextFormat("%d", game->coins);
+        cstring coins = push_frame_format(game, "%d", game->coins);
         Vector2 p = { 8*scale, 8*scale };
-        DrawTextureEx(game->texture_ui_coin, p, 0, scale, WHITE);
-        p.x += (game->texture_ui_coin.width + 1.0f) * scale;
+        draw_ui_sprite(&game->sprite_ui_coin, p, scale);
+        p.x += (game->sprite_ui_coin.region.width + 1.0f) * scale;
         p.y += scale;
         DrawTextEx(game->font_default, coins, p, 14*scale, 0, WHITE);
     }
     
     if (game->curr_tutorials) {
         cstring tutorial = "";
-        Texture2D tex = {};
+        Sprite* sprite = 0;
         if (is_tutorial_active(game, Tutorial_Walk)) {
             tutorial = "Walk";
-            tex = game->use_gamepad ? game->texture_ui_walk_gamepad : game->texture_ui_walk_keyboard;
+            sprite = game->use_gamepad ? &game->sprite_ui_walk_gamepad : &game->sprite_ui_walk_keyboard;
         } else if (is_tutorial_active(game, Tutorial_Jump)) {
             tutorial = "Jump";
-            tex = game->use_gamepad ? game->texture_ui_jump_gamepad : game->texture_ui_jump_keyboard;
+            sprite = game->use_gamepad ? &game->sprite_ui_jump_gamepad : &game->sprite_ui_jump_keyboard;
         } else if (is_tutorial_active(game, Tutorial_Long_Jump)) {
             tutorial = "Jump (hold for longer jump)";
-            tex = game->use_gamepad ? game->texture_ui_long_jump_gamepad : game->texture_ui_long_jump_keyboard;
+            sprite = game->use_gamepad ? &game->sprite_ui_long_jump_gamepad : &game->sprite_ui_long_jump_keyboard;
         } else if (is_tutorial_active(game, Tutorial_Switch_Gravity)) {
             tutorial = "Change gravity";
-            tex = game->use_gamepad ? game->texture_ui_gravity_gamepad : game->texture_ui_gravity_keyboard;
+            sprite = game->use_gamepad ? &game->sprite_ui_gravity_gamepad : &game->sprite_ui_gravity_keyboard;
         } else if (is_tutorial_active(game, Tutorial_Switch_Gravity_Midair)) {
             tutorial = "Change gravity once in midair";
-            //tex = game->use_gamepad ? game->texture_ui_gravity_gamepad : game->texture_ui_gravity_keyboard;
+            //sprite = game->use_gamepad ? &game->sprite_ui_gravity_gamepad : &game->sprite_ui_gravity_keyboard;
         }
         
         Vector2 p = { width/2.0f - 64.0f, height - 80.0f };
-        DrawTextureEx(tex, p, 0, scale, WHITE);
+        if (sprite) {
+            draw_ui_sprite(sprite, p, scale);
+        }
         p.x += 34.0f*scale;
         if (game->use_gamepad) {
             p.y += 2.0f*scale;
@@ -196,9 +612,9 @@ game_draw_ui(Game_State* game, f32 width, f32 height, f32 scale) {
         
         if (game->mode_timer > 5.5f) {
             Vector2 p = { width/2.0f - 50.0f*scale, 100.0f + 70*scale };
-            cstring coins = TextFormat("%d / %d", game->coins, game->max_coins);
-            DrawTextureEx(game->texture_ui_coin, p, 0, scale, WHITE);
-            p.x += (game->texture_ui_coin.width + 1.0f) * scale;
+            cstring coins = push_frame_format(game, "%d / %d", game->coins, game->max_coins);
+            draw_ui_sprite(&game->sprite_ui_coin, p, scale);
+            p.x += (game->sprite_ui_coin.region.width + 1.0f) * scale;
             p.y += scale;
             DrawTextEx(game->font_default, coins, p, 14*scale, 0, WHITE);
         }
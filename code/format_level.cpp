@@ -0,0 +1,308 @@
+
+// NOTE(Alexander): cooked levels hold the same data as Loaded_Tmx laid out the way the game
+// uses it, loading one is a single copy into the level arena followed by pointer fixups.
+// All fields are 32-bit and little endian so the same file works on desktop and wasm,
+// the tile map is stored as Tile so a build with a different TILE_BITS has to recook.
+// Cook them with `headless -cook` whenever a .tmx or its tileset is changed, developer
+// builds check the sources and load the .tmx instead when the cooked level is out of date.
+
+#define LEVEL_MAGIC 0x564C5347 // "GSLV"
+#define LEVEL_VERSION 3
+
+struct Level_Header {
+    u32 magic;
+    u32 version;
+    u32 size;
+    u32 tile_bits;
+    
+    s32 tile_map_width;
+    s32 tile_map_height;
+    s32 tile_width;
+    s32 tile_height;
+    
+    u32 object_offset;
+    s32 object_count;
+    u32 tile_map_offset;
+    s32 tile_map_count;
+    u32 solid_tiles_offset;
+    s32 solid_tile_count;
+    u32 names_offset;
+    u32 names_size;
+    
+    // NOTE(Alexander): crc32 of the source files when the level was cooked, the tileset
+    // path is relative to the .tmx and stored after the object names.
+    u32 tmx_crc;
+    u32 tileset_crc;
+    u32 tileset_source_offset;
+    s32 tileset_source_count;
+};
+
+struct Level_Object {
+    s32 group;
+    s32 gid;
+    v2 p;
+    v2 size;
+    u32 name_offset; // into the interned names
+    s32 name_count; // zero for objects without a name
+};
+
+inline u32
+align4(u32 offset) {
+    return (offset + 3) & ~3;
+}
+
+// NOTE(Alexander): a missing file gives the same crc as an empty one
+u32
+get_file_crc32(cstring filename) {
+    File_View file = open_file_view(filename);
+    u32 result = crc32(file.data, file.size);
+    close_file_view(&file);
+    return result;
+}
+
+bool
+cook_level(string tmx_filename, cstring level_filename, Memory_Arena* arena) {
+    Loaded_Tmx tmx = read_tmx_map_data(tmx_filename, arena);
+    if (!tmx.is_loaded) {
+        return false;
+    }
+    
+    // NOTE(Alexander): intern the object names, the same trigger name is often used many times
+    u32* name_offsets = push_array_of_structs(arena, tmx.object_count, u32, PushFlag_NoClear);
+    u32 names_size = 0;
+    for (int object_index = 0; object_index < tmx.object_count; object_index++) {
+        string name = tmx.objects[object_index].name;
+        name_offsets[object_index] = 0;
+        if (name.count == 0) continue;
+        
+        bool found = false;
+        for (int prev_index = 0; prev_index < object_index; prev_index++) {
+            if (string_equals(tmx.objects[prev_index].name, name)) {
+                name_offsets[object_index] = name_offsets[prev_index];
+                found = true;
+                break;
+            }
+        }
+        
+        if (!found) {
+            name_offsets[object_index] = names_size;
+            names_size += (u32) name.count;
+        }
+    }
+    
+    u32 tileset_source_offset = names_size;
+    names_size += (u32) tmx.tileset_source.count;
+    
+    char tmx_cfilename[256];
+    if (!string_to_cstring_buffer(tmx_filename, tmx_cfilename, sizeof(tmx_cfilename))) {
+        return false;
+    }
+    
+    Level_Header header = {};
+    header.magic = LEVEL_MAGIC;
+    header.version = LEVEL_VERSION;
+    header.tile_bits = TILE_BITS;
+    header.tile_map_width = tmx.tile_map_width;
+    header.tile_map_height = tmx.tile_map_height;
+    header.tile_width = tmx.tile_width;
+    header.tile_height = tmx.tile_height;
+    header.object_offset = (u32) sizeof(Level_Header);
+    header.object_count = tmx.object_count;
+    header.tile_map_offset = align4(header.object_offset + (u32) (tmx.object_count*sizeof(Level_Object)));
+    header.tile_map_count = tmx.tile_map_count;
+    header.solid_tiles_offset = align4(header.tile_map_offset + (u32) (tmx.tile_map_count*sizeof(Tile)));
+    header.solid_tile_count = tmx.solid_tile_count;
+    header.names_offset = align4(header.solid_tiles_offset + (u32) tmx.solid_tile_count);
+    header.names_size = names_size;
+    header.size = align4(header.names_offset + names_size);
+    header.tmx_crc = get_file_crc32(tmx_cfilename);
+    header.tileset_source_offset = tileset_source_offset;
+    header.tileset_source_count = (s32) tmx.tileset_source.count;
+    if (tmx.tileset_source.count > 0) {
+        char tileset_filename[256];
+        get_tileset_filename(tmx_filename, tmx.tileset_source, tileset_filename, sizeof(tileset_filename));
+        header.tileset_crc = get_file_crc32(tileset_filename);
+    }
+    
+    u8* blob = (u8*) push_size(arena, header.size, 4);
+    memcpy(blob, &header, sizeof(Level_Header));
+    memcpy(blob + header.tile_map_offset, tmx.tile_map, tmx.tile_map_count*sizeof(Tile));
+    for (int gid = 0; gid < tmx.solid_tile_count; gid++) {
+        blob[header.solid_tiles_offset + gid] = tmx.solid_tiles[gid] ? 1 : 0;
+    }
+    
+    Level_Object* objects = (Level_Object*) (blob + header.object_offset);
+    for (int object_index = 0; object_index < tmx.object_count; object_index++) {
+        Tmx_Object* src = &tmx.objects[object_index];
+        Level_Object* dest = &objects[object_index];
+        dest->group = src->group;
+        dest->gid = src->gid;
+        dest->p = src->p;
+        dest->size = src->size;
+        dest->name_offset = name_offsets[object_index];
+        dest->name_count = (s32) src->name.count;
+        if (src->name.count > 0) {
+            memcpy(blob + header.names_offset + dest->name_offset, src->name.data, src->name.count);
+        }
+    }
+    if (tmx.tileset_source.count > 0) {
+        memcpy(blob + header.names_offset + tileset_source_offset, tmx.tileset_source.data, tmx.tileset_source.count);
+    }
+    
+    return SaveFileData(level_filename, blob, (int) header.size);
+}
+
+// NOTE(Alexander): checks that every section of the blob is inside the file so a truncated
+// or stale file is rejected instead of read out of bounds.
+bool
+is_valid_level_blob(u8* data, int data_size) {
+    if (!data || data_size < (int) sizeof(Level_Header)) {
+        return false;
+    }
+    
+    Level_Header* header = (Level_Header*) data;
+    if (header->magic != LEVEL_MAGIC || header->version != LEVEL_VERSION || header->size != (u32) data_size ||
+        header->tile_bits != TILE_BITS) {
+        return false;
+    }
+    
+    if (header->object_count < 0 || header->tile_map_count < 0 || header->solid_tile_count < 0 ||
+        header->tile_map_count != header->tile_map_width*header->tile_map_height) {
+        return false;
+    }
+    
+    if (header->tileset_source_count < 0 ||
+        header->tileset_source_offset + (u64) header->tileset_source_count > header->names_size) {
+        return false;
+    }
+    
+    u64 size = header->size;
+    if (header->object_offset + (u64) header->object_count*sizeof(Level_Object) > size ||
+        header->tile_map_offset + (u64) header->tile_map_count*sizeof(Tile) > size ||
+        header->solid_tiles_offset + (u64) header->solid_tile_count > size ||
+        header->names_offset + (u64) header->names_size > size) {
+        return false;
+    }
+    
+    Level_Object* objects = (Level_Object*) (data + header->object_offset);
+    for (int object_index = 0; object_index < header->object_count; object_index++) {
+        Level_Object* object = &objects[object_index];
+        if (object->name_count < 0 || object->name_offset + (u64) object->name_count > header->names_size) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+Loaded_Tmx
+read_level_blob(u8* data, int data_size, Memory_Arena* arena) {
+    Loaded_Tmx result = {};
+    if (!is_valid_level_blob(data, data_size)) {
+        return result;
+    }
+    
+    u8* blob = (u8*) push_size(arena, data_size, 4, PushFlag_NoClear);
+    memcpy(blob, data, data_size);
+    
+    Level_Header* header = (Level_Header*) blob;
+    result.tile_map = (Tile*) (blob + header->tile_map_offset);
+    result.tile_map_count = header->tile_map_count;
+    result.solid_tiles = (bool*) (blob + header->solid_tiles_offset);
+    result.solid_tile_count = header->solid_tile_count;
+    result.tile_map_width = header->tile_map_width;
+    result.tile_map_height = header->tile_map_height;
+    result.tile_width = header->tile_width;
+    result.tile_height = header->tile_height;
+    
+    // NOTE(Alexander): the only work left is pointing the object names into the blob
+    Level_Object* objects = (Level_Object*) (blob + header->object_offset);
+    result.objects = push_array_of_structs(arena, header->object_count, Tmx_Object, PushFlag_NoClear);
+    result.object_count = header->object_count;
+    result.max_object_count = header->object_count;
+    for (int object_index = 0; object_index < header->object_count; object_index++) {
+        Level_Object* src = &objects[object_index];
+        Tmx_Object* dest = &result.objects[object_index];
+        dest->group = (Tmx_Object_Group) src->group;
+        dest->gid = src->gid;
+        dest->p = src->p;
+        dest->size = src->size;
+        dest->name = {};
+        if (src->name_count > 0) {
+            dest->name.data = blob + header->names_offset + src->name_offset;
+            dest->name.count = src->name_count;
+        }
+    }
+    
+    result.is_loaded = true;
+    return result;
+}
+
+// NOTE(Alexander): compares the sources against the crcs recorded when the level was cooked,
+// expects a blob that already passed is_valid_level_blob.
+bool
+is_level_blob_up_to_date(u8* data, cstring tmx_filename) {
+    Level_Header* header = (Level_Header*) data;
+    if (get_file_crc32(tmx_filename) != header->tmx_crc) {
+        return false;
+    }
+    
+    if (header->tileset_source_count > 0) {
+        string tileset_source;
+        tileset_source.data = data + header->names_offset + header->tileset_source_offset;
+        tileset_source.count = header->tileset_source_count;
+        
+        char tileset_filename[256];
+        get_tileset_filename(string_lit(tmx_filename), tileset_source, tileset_filename, sizeof(tileset_filename));
+        if (get_file_crc32(tileset_filename) != header->tileset_crc) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// NOTE(Alexander): loads a cooked .lvl level, or parses the .tmx directly for any other
+// extension. A .lvl that fails to load falls back to the .tmx next to it, in developer
+// builds so does a .lvl that was cooked before the .tmx or its tileset was last edited.
+Loaded_Tmx
+read_level(string filename, Memory_Arena* arena) {
+    string extension = string_lit(".lvl");
+    if (filename.count <= extension.count ||
+        memcmp(filename.data + filename.count - extension.count, extension.data, extension.count) != 0) {
+        return read_tmx_map_data(filename, arena);
+    }
+    
+    char tmx_filename[256];
+    snprintf(tmx_filename, sizeof(tmx_filename), "%.*s.tmx",
+             (int) (filename.count - extension.count), filename.data);
+    
+    Loaded_Tmx result = {};
+    bool is_out_of_date = false;
+    char cfilename[256];
+    if (string_to_cstring_buffer(filename, cfilename, sizeof(cfilename))) {
+        File_View file = open_file_view(cfilename);
+#if DEVELOPER
+        if (is_valid_level_blob(file.data, (int) file.size)) {
+            is_out_of_date = !is_level_blob_up_to_date(file.data, tmx_filename);
+        }
+#endif
+        if (!is_out_of_date) {
+            result = read_level_blob(file.data, (int) file.size, arena);
+        }
+        close_file_view(&file);
+    }
+    
+    if (!result.is_loaded) {
+        if (is_out_of_date) {
+            pln("warning: cooked level %.*s is out of date, loading %s (recook with headless -cook)",
+                (int) filename.count, filename.data, tmx_filename);
+        } else {
+            pln("warning: cooked level %.*s is missing or invalid, loading %s",
+                (int) filename.count, filename.data, tmx_filename);
+        }
+        result = read_tmx_map_data(string_lit(tmx_filename), arena);
+    }
+    
+    return result;
+}
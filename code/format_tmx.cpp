@@ -19,14 +19,22 @@ struct Tmx_Object {
 struct Loaded_Tmx {
     Tmx_Object* objects;
     
-    u8* tile_map;
+    Tile* tile_map;
     s32 tile_map_count;
+    
+    // NOTE(Alexander): indexed by tile gid, all tiles are solid unless the tileset says otherwise
+    bool* solid_tiles;
+    s32 solid_tile_count;
+    
+    string tileset_source;
+    s32 tileset_first_gid;
     s32 tile_map_width;
     s32 tile_map_height;
     s32 tile_width;
     s32 tile_height;
     
     s32 object_count;
+    s32 max_object_count;
     
     s32 is_loaded;
 };
@@ -48,9 +56,172 @@ free_file_data(void* data) {
     UnloadFileData((u8*) data);
 }
 
-//Loaded_Tmx read_tmx_map_data(u8* scan, Memory_Arena* arena);
-void read_tmx_tile_map(u8** scanner, Loaded_Tmx* result);
-void read_tmx_objects(u8** scanner, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Object_Group group);
+// NOTE(Alexander): read only view of a whole file, on linux the file is memory mapped so
+// the parser scans the page cache directly, elsewhere it falls back to LoadFileData.
+#if defined(__linux__) && !defined(PLATFORM_WEB)
+#define USE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define USE_MMAP 0
+#endif
+
+struct File_View {
+    u8* data;
+    umm size;
+    bool is_mapped;
+};
+
+File_View
+open_file_view(cstring filename) {
+    File_View result = {};
+    
+#if USE_MMAP
+    int fd = open(filename, O_RDONLY);
+    if (fd >= 0) {
+        struct stat file_stat;
+        if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+            void* data = mmap(0, (umm) file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) {
+                result.data = (u8*) data;
+                result.size = (umm) file_stat.st_size;
+                result.is_mapped = true;
+            }
+        }
+        close(fd);
+        
+        if (result.is_mapped) {
+            return result;
+        }
+    }
+#endif
+    
+    Read_File_Result file = read_entire_file(filename);
+    result.data = (u8*) file.contents;
+    result.size = file.contents ? (umm) file.contents_size : 0;
+    return result;
+}
+
+void
+close_file_view(File_View* view) {
+#if USE_MMAP
+    if (view->is_mapped) {
+        munmap(view->data, view->size);
+        *view = {};
+        return;
+    }
+#endif
+    
+    if (view->data) {
+        free_file_data(view->data);
+    }
+    *view = {};
+}
+
+// Returns false if the filename doesn't fit, avoids a heap allocation for every file opened
+inline bool
+string_to_cstring_buffer(string str, char* buffer, umm buffer_size) {
+    if (str.count + 1 > buffer_size) {
+        return false;
+    }
+    string_to_cstring(str, (u8*) buffer);
+    return true;
+}
+
+void read_tsx_tileset(u8* scan, u8* end, Memory_Arena* arena, Loaded_Tmx* result);
+void read_tmx_tile_map(u8** scanner, u8* end, Loaded_Tmx* result);
+void read_tmx_object(u8** scanner, u8* end, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Object_Group group);
+
+enum Tmx_Attribute {
+    TmxAttribute_None,
+    TmxAttribute_Width,
+    TmxAttribute_Height,
+    TmxAttribute_TileWidth,
+    TmxAttribute_TileHeight,
+    TmxAttribute_FirstGid,
+    TmxAttribute_Source,
+    TmxAttribute_TileCount,
+    TmxAttribute_Name,
+    TmxAttribute_Gid,
+    TmxAttribute_X,
+    TmxAttribute_Y,
+    TmxAttribute_Id,
+    TmxAttribute_Value,
+    TmxAttribute_Encoding,
+    TmxAttribute_Compression,
+};
+
+enum Tmx_Compression {
+    TmxCompression_None,
+    TmxCompression_Zlib,
+    TmxCompression_Gzip,
+    TmxCompression_Unsupported,
+};
+
+bool read_tmx_base64_tile_map(u8** scanner, u8* end, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Compression compression);
+
+struct Tmx_Attribute_Entry {
+    cstring name;
+    smm count;
+    Tmx_Attribute attribute;
+};
+
+// NOTE(Alexander): perfect hash of the attribute names we care about, built from the first
+// and last character and the length. Any other attribute either lands in an empty slot or
+// fails the compare. Check for collisions when adding a new name!
+#define TMX_ATTRIBUTE_HASH_SIZE 32
+#define hash_tmx_attribute(name) \
+(((name).data[0]*14 + (name).data[(name).count - 1]*22 + (u32) (name).count) & (TMX_ATTRIBUTE_HASH_SIZE - 1))
+
+const Tmx_Attribute_Entry tmx_attribute_table[TMX_ATTRIBUTE_HASH_SIZE] = {
+    {},
+    { "x", 1, TmxAttribute_X },
+    {},
+    {},
+    {},
+    { "y", 1, TmxAttribute_Y },
+    {},
+    { "value", 5, TmxAttribute_Value },
+    { "encoding", 8, TmxAttribute_Encoding },
+    { "compression", 11, TmxAttribute_Compression },
+    {},
+    {},
+    {},
+    {},
+    { "height", 6, TmxAttribute_Height },
+    {},
+    {},
+    { "tilewidth", 9, TmxAttribute_TileWidth },
+    {},
+    {},
+    { "firstgid", 8, TmxAttribute_FirstGid },
+    {},
+    { "name", 4, TmxAttribute_Name },
+    { "width", 5, TmxAttribute_Width },
+    { "id", 2, TmxAttribute_Id },
+    { "tilecount", 9, TmxAttribute_TileCount },
+    { "tileheight", 10, TmxAttribute_TileHeight },
+    {},
+    {},
+    { "gid", 3, TmxAttribute_Gid },
+    { "source", 6, TmxAttribute_Source },
+    {},
+};
+
+Tmx_Attribute
+get_tmx_attribute(string name) {
+    if (name.count == 0) {
+        return TmxAttribute_None;
+    }
+    
+    const Tmx_Attribute_Entry* entry = &tmx_attribute_table[hash_tmx_attribute(name)];
+    if (entry->count == name.count && memcmp(entry->name, name.data, name.count) == 0) {
+        return entry->attribute;
+    }
+    return TmxAttribute_None;
+}
 
 
 // TODO(Alexander): we are currently storing resulting objects and colliders
@@ -59,77 +230,107 @@ void read_tmx_objects(u8** scanner, Memory_Arena* arena, Loaded_Tmx* result, Tmx
 // stream chunks instead we have to store the entites in a more sophisticated manner.
 
 Loaded_Tmx
-read_tmx_map_data(u8* scan, Memory_Arena* arena) {
+read_tmx_map_data(u8* scan, u8* end, Memory_Arena* arena) {
     Loaded_Tmx result = {};
+    Tmx_Object_Group group = TmxObjectGroup_Entities;
+    bool is_in_object_group = false;
     
-    // NOTE(Alexander): first loads general information about the map
-    for (; *scan; scan++) {
-        if (eat_string(&scan, "<map")) {
-            for (; *scan; scan++) {
-                if (eat_string(&scan, ">")) {
-                    break;
+    // NOTE(Alexander): a single pass over the tags, find_byte jumps straight to the next '<'
+    // and the attributes of each tag are lexed once and dispatched on their name.
+    while ((scan = find_byte(scan, end, '<')) < end) {
+        scan++;
+        string tag = eat_xml_tag_name(&scan, end);
+        Xml_Attribute attribute = {};
+        
+        if (string_equals(tag, string_lit("map"))) {
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_Width: result.tile_map_width = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Height: result.tile_map_height = string_to_integer(attribute.value); break;
+                    case TmxAttribute_TileWidth: result.tile_width = string_to_integer(attribute.value); break;
+                    case TmxAttribute_TileHeight: result.tile_height = string_to_integer(attribute.value); break;
                 }
-                if (eat_string(&scan, " width=\"")) {
-                    result.tile_map_width = eat_integer(&scan);
-                } else if (eat_string(&scan, " height=\"")) {
-                    result.tile_map_height = eat_integer(&scan);
-                } else if (eat_string(&scan, " tilewidth=\"")) {
-                    result.tile_width = eat_integer(&scan);
-                } else if (eat_string(&scan, " tileheight=\"")) {
-                    result.tile_height = eat_integer(&scan);
+            }
+            
+            if (result.tile_map_width == 0 || result.tile_map_height == 0 || 
+                result.tile_width == 0 || result.tile_height == 0) {
+                pln("Tiled map is corrupt");// TODO(Alexander): logging system
+                return result;
+            }
+            
+            int tile_count = result.tile_map_width * result.tile_map_height;
+            // NOTE(Alexander): this has to be cleared, infinite maps only store the chunks that have tiles
+            result.tile_map = push_array_of_structs(arena, tile_count, Tile);
+            result.tile_map_count = tile_count;
+            
+        } else if (string_equals(tag, string_lit("tileset"))) {
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_FirstGid: result.tileset_first_gid = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Source: result.tileset_source = attribute.value; break;
                 }
             }
             
-            break;
-        }
-    }
-    
-    if (result.tile_map_width == 0 || result.tile_map_height == 0 || 
-        result.tile_width == 0 || result.tile_height == 0) {
-        pln("Tiled map is corrupt");// TODO(Alexander): logging system
-        return result;
-    }
-    
-    int tile_count = result.tile_map_width * result.tile_map_height;
-    result.tile_map = push_array_of_structs(arena, tile_count, u8);
-    result.tile_map_count = tile_count;
-    //result.tile_map_count = tile_count;
-    
-    //result.tile_map.data = (Tile*) push_size(arena, tile_count*sizeof(Tile));
-    
-    // NOTE(Alexander): Load all the layers
-    for (; *scan; scan++) {
-        if (eat_string(&scan, "<layer")) {
-            for (; *scan; scan++) {
-                if (eat_string(&scan, "</layer>")) {
-                    break;
+        } else if (string_equals(tag, string_lit("data"))) {
+            string encoding = {};
+            Tmx_Compression compression = TmxCompression_None;
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_Encoding: encoding = attribute.value; break;
+                    
+                    case TmxAttribute_Compression: {
+                        if (string_equals(attribute.value, string_lit("zlib"))) {
+                            compression = TmxCompression_Zlib;
+                        } else if (string_equals(attribute.value, string_lit("gzip"))) {
+                            compression = TmxCompression_Gzip;
+                        } else {
+                            compression = TmxCompression_Unsupported;
+                        }
+                    } break;
                 }
-                if (eat_string(&scan, "<data encoding=\"csv\">")) {
-                    read_tmx_tile_map(&scan, &result);
+            }
+            
+            if (!result.tile_map) {
+                continue;
+            }
+            
+            if (string_equals(encoding, string_lit("csv"))) {
+                read_tmx_tile_map(&scan, end, &result);
+            } else if (string_equals(encoding, string_lit("base64")) && compression != TmxCompression_Unsupported) {
+                if (!read_tmx_base64_tile_map(&scan, end, arena, &result, compression)) {
+                    pln("warning: failed to decode the tile layer data");
                 }
+            } else {
+                // TODO(Alexander): zstd needs a decoder we don't have, and the xml encoding is deprecated
+                pln("warning: unsupported tile layer format, save the map as CSV or Base64 (zlib/gzip compressed)");
             }
-        }
-        
-        if (eat_string(&scan, "<objectgroup")) {
-            for (; *scan; scan++) {
-                if (eat_string(&scan, " name=\"")) {
-                    string name = eat_until(&scan,'"');
-                    
-                    if (string_equals(name, string_lit("Entities"))) {
-                        read_tmx_objects(&scan, arena, &result, TmxObjectGroup_Entities);
-                    } else if (string_equals(name, string_lit("Colliders"))) {
-                        read_tmx_objects(&scan, arena, &result, TmxObjectGroup_Colliders);
-                    } else if (string_equals(name, string_lit("Triggers"))) {
-                        read_tmx_objects(&scan, arena, &result, TmxObjectGroup_Triggers);
-                    } else if (string_equals(name, string_lit("Checkpoints"))) {
-                        read_tmx_objects(&scan, arena, &result, TmxObjectGroup_Checkpoints);
-                    } else {
-                        pln("Invalid object group: %.*s", (int) name.count, name.data);
-                        assert(0 && "invalid objectgroup found");
-                    }
-                    break;
+            
+        } else if (string_equals(tag, string_lit("objectgroup"))) {
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                if (get_tmx_attribute(attribute.name) != TmxAttribute_Name) continue;
+                
+                string name = attribute.value;
+                is_in_object_group = true;
+                if (string_equals(name, string_lit("Entities"))) {
+                    group = TmxObjectGroup_Entities;
+                } else if (string_equals(name, string_lit("Colliders"))) {
+                    group = TmxObjectGroup_Colliders;
+                } else if (string_equals(name, string_lit("Triggers"))) {
+                    group = TmxObjectGroup_Triggers;
+                } else if (string_equals(name, string_lit("Checkpoints"))) {
+                    group = TmxObjectGroup_Checkpoints;
+                } else {
+                    pln("Invalid object group: %.*s", (int) name.count, name.data);
+                    assert(0 && "invalid objectgroup found");
+                    is_in_object_group = false;
                 }
             }
+            
+        } else if (string_equals(tag, string_lit("/objectgroup"))) {
+            is_in_object_group = false;
+            
+        } else if (string_equals(tag, string_lit("object")) && is_in_object_group && result.tile_map) {
+            read_tmx_object(&scan, end, arena, &result, group);
         }
     }
     
@@ -141,136 +342,363 @@ read_tmx_map_data(u8* scan, Memory_Arena* arena) {
         }
     }
     
-    result.is_loaded = true;
+    result.is_loaded = result.tile_map != 0;
     return result;
 }
 
+// NOTE(Alexander): the tileset path is relative to the map file
+void
+get_tileset_filename(string map_filename, string tileset_source, char* buffer, int buffer_size) {
+    smm dir_count = map_filename.count;
+    while (dir_count > 0 && map_filename.data[dir_count - 1] != '/' && map_filename.data[dir_count - 1] != '\\') {
+        dir_count--;
+    }
+    
+    snprintf(buffer, buffer_size, "%.*s%.*s",
+             (int) dir_count, map_filename.data,
+             (int) tileset_source.count, tileset_source.data);
+}
+
 Loaded_Tmx
 read_tmx_map_data(string filename,
                   Memory_Arena* arena) {
+    Loaded_Tmx result = {};
     
+    char cfilename[256];
+    if (!string_to_cstring_buffer(filename, cfilename, sizeof(cfilename))) {
+        pln("warning: filename is too long %.*s", (int) filename.count, filename.data);
+        return result;
+    }
     
-    cstring cfilename = string_to_cstring(filename);
-    Read_File_Result file = read_entire_file(cfilename);
-    cstring_free(cfilename);
+    File_View file = open_file_view(cfilename);
+    if (!file.data) {
+        pln("warning: failed to load %s", cfilename);
+        return result;
+    }
     
+    // NOTE(Alexander): strings returned by the parser point into the file until they are copied
+    result = read_tmx_map_data(file.data, file.data + file.size, arena);
     
-    Loaded_Tmx result = read_tmx_map_data((u8*) file.contents, arena);
-    free_file_data(file.contents);
+    if (result.is_loaded && result.tileset_source.count > 0) {
+        char tileset_filename[256];
+        get_tileset_filename(filename, result.tileset_source, tileset_filename, sizeof(tileset_filename));
+        
+        File_View tileset_file = open_file_view(tileset_filename);
+        if (tileset_file.data) {
+            read_tsx_tileset(tileset_file.data, tileset_file.data + tileset_file.size, arena, &result);
+            close_file_view(&tileset_file);
+        } else {
+            pln("warning: failed to load tileset %s", tileset_filename);
+        }
+    }
+    
+    // NOTE(Alexander): the level cooker records which tileset the level was cooked from
+    if (result.tileset_source.count > 0) {
+        result.tileset_source = push_string(arena, result.tileset_source);
+    } else {
+        result.tileset_source = {};
+    }
     
+    close_file_view(&file);
     
     return result;
 }
 
 void
-read_tmx_tile_map(u8** scanner, Loaded_Tmx* result) {
+read_tsx_tileset(u8* scan, u8* end, Memory_Arena* arena, Loaded_Tmx* result) {
+    s32 first_gid = result->tileset_first_gid;
+    s32 gid = -1;
+    
+    while ((scan = find_byte(scan, end, '<')) < end) {
+        scan++;
+        string tag = eat_xml_tag_name(&scan, end);
+        Xml_Attribute attribute = {};
+        
+        if (string_equals(tag, string_lit("tileset"))) {
+            s32 tile_count = 0;
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                if (get_tmx_attribute(attribute.name) == TmxAttribute_TileCount) {
+                    tile_count = string_to_integer(attribute.value);
+                }
+            }
+            
+            result->solid_tile_count = first_gid + tile_count;
+            result->solid_tiles = push_array_of_structs(arena, result->solid_tile_count, bool);
+            for (s32 tile_gid = first_gid; tile_gid < result->solid_tile_count; tile_gid++) {
+                result->solid_tiles[tile_gid] = true;
+            }
+            
+        } else if (string_equals(tag, string_lit("tile"))) {
+            gid = -1;
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                if (get_tmx_attribute(attribute.name) == TmxAttribute_Id) {
+                    gid = first_gid + string_to_integer(attribute.value);
+                }
+            }
+            if (attribute.is_empty_tag) {
+                gid = -1;
+            }
+            
+        } else if (string_equals(tag, string_lit("/tile"))) {
+            gid = -1;
+            
+        } else if (string_equals(tag, string_lit("property"))) {
+            // NOTE(Alexander): tiles can opt out of collision with a bool property solid=false
+            bool is_solid_property = false;
+            bool is_false = false;
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_Name: is_solid_property = string_equals(attribute.value, string_lit("solid")); break;
+                    case TmxAttribute_Value: is_false = string_equals(attribute.value, string_lit("false")); break;
+                }
+            }
+            
+            if (is_solid_property && is_false && result->solid_tiles && 
+                gid >= 0 && gid < result->solid_tile_count) {
+                result->solid_tiles[gid] = false;
+            }
+        }
+    }
+}
+
+// NOTE(Alexander): Tiled stores the flip flags in the top bits of the 32-bit gid,
+// they are moved down to the top bits of our smaller Tile.
+inline Tile
+tmx_gid_to_tile(u32 gid) {
+    u32 tile_gid = gid & 0x0FFFFFFF;
+    if (tile_gid > TILE_GID_MASK) {
+        pln("warning: tile gid %u doesn't fit in %d bits, build with a larger TILE_BITS", tile_gid, TILE_BITS);
+        return 0;
+    }
+    
+    u32 result = tile_gid;
+    if (gid & 0x80000000) result |= TILE_FLIP_HORIZONTAL;
+    if (gid & 0x40000000) result |= TILE_FLIP_VERTICAL;
+    if (gid & 0x20000000) result |= TILE_FLIP_DIAGONAL;
+    return (Tile) result;
+}
+
+void
+read_tmx_tile_map(u8** scanner, u8* end, Loaded_Tmx* result) {
     s32 tile_index = 0;
     s32 chunk_width = 0;
+    s32 chunk_column = 0;
+    u32 gid = 0;
+    bool has_gid = false;
     
     u8* scan = *scanner;
-    for (; *scan; scan++) {
-        if (eat_string(&scan, "</data>")) {
-            break;
+    while (scan < end) {
+        u8 character = *scan;
+        if (character >= '0' && character <= '9') {
+            gid = gid*10 + (u32) (character - '0');
+            has_gid = true;
+            scan++;
+            continue;
         }
         
-        if (*scan == ',') {
+        // NOTE(Alexander): the last tile of the layer and of each chunk has no comma after it
+        if (has_gid) {
+            assert(tile_index < result->tile_map_count && "number of tiles exceeds its limit");
+            if (tile_index < result->tile_map_count) {
+                result->tile_map[tile_index] = tmx_gid_to_tile(gid);
+            }
+            gid = 0;
+            has_gid = false;
+        }
+        
+        if (character == ',') {
             scan++;
             tile_index++;
             
-            assert(tile_index < result->tile_map_count && "number of tiles exceeds its limit");
+            if (chunk_width > 0 && ++chunk_column == chunk_width) {
+                chunk_column = 0;
+                tile_index += result->tile_map_width - chunk_width;
+            }
             
-            if (chunk_width > 0) {
-                if ((tile_index % chunk_width) == 0) {
-                    tile_index += result->tile_map_width - chunk_width;
+        } else if (character == '<') {
+            scan++;
+            string tag = eat_xml_tag_name(&scan, end);
+            bool is_chunk = string_equals(tag, string_lit("chunk"));
+            
+            int chunk_x = 0;
+            int chunk_y = 0;
+            Xml_Attribute attribute = {};
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                if (!is_chunk) continue;
+                
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_X: chunk_x = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Y: chunk_y = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Width: chunk_width = string_to_integer(attribute.value); break;
                 }
             }
             
-            result->tile_map[tile_index] = 0;
+            if (string_equals(tag, string_lit("/data"))) {
+                break;
+            }
+            
+            if (is_chunk) {
+                assert(chunk_x >= 0 && chunk_y >= 0 && "chunks needs to first be normalized");
+                tile_index = chunk_y*result->tile_map_width + chunk_x;
+                chunk_column = 0;
+                //pln("parsed chunk: x=%, y=%, width=%, tile_index = %", chunk_x, chunk_y, chunk_width, tile_index);
+            }
+            
+        } else {
+            scan++;
         }
-        
-        if (*scan == ' ' || *scan == '\n' || *scan == '\t' || *scan == '\r' || 
-            eat_string(&scan, "</chunk>")) {
-            continue;
+    }
+    
+    *scanner = scan;
+}
+
+// NOTE(Alexander): decodes one block of little endian u32 gids stored as base64 and
+// optionally compressed. The block is placed at the given tile and clipped to the map.
+bool
+read_tmx_tile_block(u8** scanner, u8* end, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Compression compression, 
+                    s32 x, s32 y, s32 width, s32 height) {
+    if (width <= 0 || height <= 0) {
+        return false;
+    }
+    
+    u8* text_end = find_byte(*scanner, end, '<');
+    umm text_size = (umm) (text_end - *scanner);
+    umm gids_size = (umm) width*height*sizeof(u32);
+    
+    Temp_Memory temp = begin_temporary_memory(arena);
+    u8* decoded = (u8*) push_size(arena, text_size/4*3 + 3, 4, PushFlag_NoClear);
+    smm decoded_size = eat_base64(scanner, text_end, decoded, text_size/4*3 + 3);
+    
+    u8* gids = decoded;
+    smm size = decoded_size;
+    if (decoded_size >= 0 && compression != TmxCompression_None) {
+        gids = (u8*) push_size(arena, gids_size, 4, PushFlag_NoClear);
+        if (compression == TmxCompression_Zlib) {
+            size = zlib_decompress(gids, gids_size, decoded, (umm) decoded_size);
+        } else {
+            size = gzip_decompress(gids, gids_size, decoded, (umm) decoded_size);
         }
-        
-        if (eat_string(&scan, "<chunk")) {
-            int chunk_x = 0;
-            int chunk_y = 0;
-            for (; *scan; scan++) {
-                if (eat_string(&scan, ">")) {
-                    assert(chunk_x >= 0 && chunk_y >= 0 && "chunks needs to first be normalized");
-                    tile_index = chunk_y*result->tile_map_width + chunk_x;
-                    break;
-                }
-                if (eat_string(&scan, " x=\"")) {
-                    chunk_x = eat_integer(&scan);
-                } else if (eat_string(&scan, " y=\"")) {
-                    chunk_y = eat_integer(&scan);
-                } else if (eat_string(&scan, " width=\"")) {
-                    chunk_width = eat_integer(&scan);
+    }
+    
+    bool is_valid = size == (smm) gids_size;
+    if (is_valid) {
+        for (s32 row = 0; row < height; row++) {
+            s32 tile_y = y + row;
+            if (tile_y < 0 || tile_y >= result->tile_map_height) continue;
+            
+            for (s32 column = 0; column < width; column++) {
+                s32 tile_x = x + column;
+                if (tile_x < 0 || tile_x >= result->tile_map_width) continue;
+                
+                u32 gid;
+                memcpy(&gid, gids + (row*width + column)*sizeof(u32), sizeof(u32));
+                result->tile_map[tile_y*result->tile_map_width + tile_x] = tmx_gid_to_tile(gid);
+            }
+        }
+    }
+    
+    end_temporary_memory(temp);
+    return is_valid;
+}
+
+bool
+read_tmx_base64_tile_map(u8** scanner, u8* end, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Compression compression) {
+    bool is_valid = true;
+    u8* scan = *scanner;
+    while (scan < end && is_xml_whitespace(*scan)) {
+        scan++;
+    }
+    
+    if (scan < end && *scan != '<') {
+        is_valid = read_tmx_tile_block(&scan, end, arena, result, compression, 0, 0, 
+                                        result->tile_map_width, result->tile_map_height);
+    } else {
+        // NOTE(Alexander): infinite maps store the layer as chunks instead
+        while ((scan = find_byte(scan, end, '<')) < end) {
+            scan++;
+            string tag = eat_xml_tag_name(&scan, end);
+            if (string_equals(tag, string_lit("/data"))) {
+                break;
+            }
+            if (!string_equals(tag, string_lit("chunk"))) {
+                continue;
+            }
+            
+            s32 chunk_x = 0;
+            s32 chunk_y = 0;
+            s32 chunk_width = 0;
+            s32 chunk_height = 0;
+            Xml_Attribute attribute = {};
+            while (eat_xml_attribute(&scan, end, &attribute)) {
+                switch (get_tmx_attribute(attribute.name)) {
+                    case TmxAttribute_X: chunk_x = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Y: chunk_y = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Width: chunk_width = string_to_integer(attribute.value); break;
+                    case TmxAttribute_Height: chunk_height = string_to_integer(attribute.value); break;
                 }
             }
             
-            result->tile_map[tile_index] = 0;
-            //pln("parsed chunk: x=%, y=%, width=%, tile_index = %", chunk_x, chunk_y, chunk_width, tile_index);
-            continue;
-        }
-        
-        int number = (int) (*scan - '0');
-        if (number >= 0 && number <= 9) {
-            u8 data = result->tile_map[tile_index];
-            result->tile_map[tile_index] = (u8) (data*10 + number);
-            //pln("number: %, tile: % = %", number, tile_index, (int) result->tile_map[tile_index]);
+            if (!read_tmx_tile_block(&scan, end, arena, result, compression, 
+                                     chunk_x, chunk_y, chunk_width, chunk_height)) {
+                is_valid = false;
+            }
         }
     }
+    
+    *scanner = scan;
+    return is_valid;
 }
 
 void
-read_tmx_objects(u8** scanner, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Object_Group group) {
-    for (u8* scan = *scanner; *scan; scan++) {
-        if (eat_string(&scan, "/>") || eat_string(&scan, "</objectgroup>")) {
-            break;
+read_tmx_object(u8** scanner, u8* end, Memory_Arena* arena, Loaded_Tmx* result, Tmx_Object_Group group) {
+    // NOTE(Alexander): arena blocks are chained so objects have to be grown
+    // as one array, the old array is reclaimed when the level arena is cleared.
+    if (result->object_count >= result->max_object_count) {
+        s32 max_object_count = max(result->max_object_count*2, 64);
+        Tmx_Object* objects = push_array_of_structs(arena, max_object_count, Tmx_Object);
+        if (result->object_count > 0) {
+            memcpy(objects, result->objects, result->object_count*sizeof(Tmx_Object));
         }
-        
-        if (eat_string(&scan, "<object")) {
-            Tmx_Object* object = push_struct(arena, Tmx_Object);
-            object->group = group;
-            result->object_count++;
+        result->objects = objects;
+        result->max_object_count = max_object_count;
+    }
+    
+    Tmx_Object* object = &result->objects[result->object_count++];
+    object->group = group;
+    
+    // NOTE(Alexander): Tiled stores positions in pixels and can write fractional values
+    Xml_Attribute attribute = {};
+    while (eat_xml_attribute(scanner, end, &attribute)) {
+        switch (get_tmx_attribute(attribute.name)) {
+            case TmxAttribute_Name: {
+                object->name = attribute.value;
+            } break;
             
-            if (!result->objects) {
-                result->objects = object;
-            }
+            case TmxAttribute_Gid: {
+                // NOTE(Alexander): the top bits are flip flags, so parse the whole 32 bits
+                object->gid = (s32) string_to_u32(attribute.value);
+            } break;
             
-            for (; *scan; scan++) {
-                if (eat_string(&scan, "/>") || eat_string(&scan, "</object>")) {
-                    break;
-                }
+            case TmxAttribute_X: {
+                object->p.x = string_to_f32(attribute.value)/(f32) result->tile_width;
+            } break;
+            
+            case TmxAttribute_Y: {
+                object->p.y = string_to_f32(attribute.value)/(f32) result->tile_height;
                 
-                if (eat_string(&scan, "name=\"")) {
-                    object->name = eat_until_excluding_end(&scan,'"');
-                    //pln("%d: name = %.*s", group, (int) object->name.count, object->name.data);
-                } else if (eat_string(&scan, "gid=\"")) {
-                    object->gid = eat_integer(&scan);
-                    //pln("gid=%d", object->gid);
-                } else if (eat_string(&scan, "x=\"")) {
-                    f32 x = (f32) eat_integer(&scan);
-                    object->p.x = x/(f32) result->tile_width;
-                } else if (eat_string(&scan, "y=\"")) {
-                    f32 y = (f32) eat_integer(&scan);
-                    object->p.y = y/(f32) result->tile_height;
-                    
-                    // wtf tiled why?
-                    if (group == TmxObjectGroup_Entities) {
-                        object->p.y -= 1.0f;
-                    }
-                } else if (eat_string(&scan, "width=\"")) {
-                    f32 width = (f32) eat_integer(&scan);
-                    object->size.width = width/(f32) result->tile_width;
-                } else if (eat_string(&scan, "height=\"")) {
-                    f32 height = (f32) eat_integer(&scan);
-                    object->size.height = height/(f32) result->tile_height; 
+                // wtf tiled why?
+                if (group == TmxObjectGroup_Entities) {
+                    object->p.y -= 1.0f;
                 }
-            }
+            } break;
+            
+            case TmxAttribute_Width: {
+                object->size.width = string_to_f32(attribute.value)/(f32) result->tile_width;
+            } break;
+            
+            case TmxAttribute_Height: {
+                object->size.height = string_to_f32(attribute.value)/(f32) result->tile_height;
+            } break;
         }
     }
 }
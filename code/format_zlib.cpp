@@ -0,0 +1,487 @@
+
+// NOTE(Alexander): small DEFLATE decoder (RFC 1951) for zlib (RFC 1950) and gzip (RFC 1952)
+// streams, only used for compressed Tiled layers. The output size is always known up front
+// so everything is decoded straight into a buffer given by the caller, nothing is allocated.
+
+#define INFLATE_MAX_BITS 15
+#define INFLATE_FAST_BITS 10
+
+struct Inflate_Huffman {
+    // NOTE(Alexander): indexed by the next INFLATE_FAST_BITS bits of the stream,
+    // stores (code length << 9) | symbol and zero for codes longer than that.
+    u16 fast[1 << INFLATE_FAST_BITS];
+    u16 counts[INFLATE_MAX_BITS + 1];
+    u16 symbols[288];
+};
+
+struct Inflate_State {
+    u8* at;
+    u8* end;
+    u64 bit_buffer;
+    s32 bit_count;
+    s32 overrun_bits; // zero bits shifted in past the end of the input
+    
+    u8* dest;
+    umm dest_size;
+    umm dest_used;
+};
+
+const u16 inflate_length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+    35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+const u8 inflate_length_extra[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+    3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+const u16 inflate_dist_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+    257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+const u8 inflate_dist_extra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+    7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+inline void
+inflate_refill(Inflate_State* state) {
+    while (state->bit_count <= 56) {
+        if (state->at < state->end) {
+            state->bit_buffer |= (u64) *state->at++ << state->bit_count;
+        } else {
+            state->overrun_bits += 8;
+        }
+        state->bit_count += 8;
+    }
+}
+
+inline u32
+inflate_bits(Inflate_State* state, s32 count) {
+    if (state->bit_count < count) {
+        inflate_refill(state);
+    }
+    u32 result = (u32) (state->bit_buffer & ((1ull << count) - 1));
+    state->bit_buffer >>= count;
+    state->bit_count -= count;
+    return result;
+}
+
+// NOTE(Alexander): lengths are indexed by symbol, returns false for over-subscribed codes.
+// Incomplete codes are allowed, e.g. a single distance code.
+bool
+build_inflate_huffman(Inflate_Huffman* huffman, u8* lengths, int symbol_count) {
+    memset(huffman->counts, 0, sizeof(huffman->counts));
+    memset(huffman->fast, 0, sizeof(huffman->fast));
+    for (int symbol = 0; symbol < symbol_count; symbol++) {
+        huffman->counts[lengths[symbol]]++;
+    }
+    huffman->counts[0] = 0;
+    
+    u16 offsets[INFLATE_MAX_BITS + 1];
+    u32 next_code[INFLATE_MAX_BITS + 1];
+    s32 left = 1;
+    u32 code = 0;
+    offsets[1] = 0;
+    for (int length = 1; length <= INFLATE_MAX_BITS; length++) {
+        left = (left << 1) - huffman->counts[length];
+        if (left < 0) {
+            return false;
+        }
+        
+        next_code[length] = code;
+        code = (code + huffman->counts[length]) << 1;
+        if (length < INFLATE_MAX_BITS) {
+            offsets[length + 1] = (u16) (offsets[length] + huffman->counts[length]);
+        }
+    }
+    
+    for (int symbol = 0; symbol < symbol_count; symbol++) {
+        int length = lengths[symbol];
+        if (length == 0) continue;
+        
+        huffman->symbols[offsets[length]++] = (u16) symbol;
+        
+        // NOTE(Alexander): codes are stored most significant bit first, reverse them so
+        // the fast table can be indexed with the low bits of the bit buffer.
+        u32 reversed = 0;
+        u32 symbol_code = next_code[length]++;
+        for (int bit_index = 0; bit_index < length; bit_index++) {
+            reversed = (reversed << 1) | ((symbol_code >> bit_index) & 1);
+        }
+        
+        if (length <= INFLATE_FAST_BITS) {
+            for (u32 index = reversed; index < (1u << INFLATE_FAST_BITS); index += 1u << length) {
+                huffman->fast[index] = (u16) ((length << 9) | symbol);
+            }
+        }
+    }
+    
+    return true;
+}
+
+// NOTE(Alexander): returns -1 for bit patterns without a code
+inline s32
+inflate_decode(Inflate_State* state, Inflate_Huffman* huffman) {
+    if (state->bit_count < INFLATE_MAX_BITS) {
+        inflate_refill(state);
+    }
+    
+    u16 entry = huffman->fast[state->bit_buffer & ((1 << INFLATE_FAST_BITS) - 1)];
+    if (entry) {
+        s32 length = entry >> 9;
+        state->bit_buffer >>= length;
+        state->bit_count -= length;
+        return entry & 511;
+    }
+    
+    // Long codes are decoded one bit at a time
+    s32 code = 0;
+    s32 first = 0;
+    s32 index = 0;
+    for (s32 length = 1; length <= INFLATE_MAX_BITS; length++) {
+        code |= (s32) inflate_bits(state, 1);
+        s32 count = huffman->counts[length];
+        if (code - count < first) {
+            return huffman->symbols[index + (code - first)];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+bool
+inflate_codes(Inflate_State* state, Inflate_Huffman* lengths, Inflate_Huffman* distances) {
+    u8* dest = state->dest;
+    umm used = state->dest_used;
+    while (true) {
+        s32 symbol = inflate_decode(state, lengths);
+        if (symbol < 0) {
+            return false;
+        }
+        
+        if (symbol < 256) {
+            if (used >= state->dest_size) {
+                return false;
+            }
+            dest[used++] = (u8) symbol;
+            
+        } else if (symbol == 256) {
+            break;
+            
+        } else {
+            symbol -= 257;
+            if (symbol >= 29) {
+                return false;
+            }
+            umm length = inflate_length_base[symbol] + inflate_bits(state, inflate_length_extra[symbol]);
+            
+            s32 dist_symbol = inflate_decode(state, distances);
+            if (dist_symbol < 0 || dist_symbol >= 30) {
+                return false;
+            }
+            umm dist = inflate_dist_base[dist_symbol] + inflate_bits(state, inflate_dist_extra[dist_symbol]);
+            if (dist > used || length > state->dest_size - used) {
+                return false;
+            }
+            
+            // NOTE(Alexander): the copy can overlap its own output, e.g. a run of one byte.
+            // Tile data mostly repeats whole 4 byte gids so copy in the largest step that
+            // doesn't read bytes that aren't written yet.
+            u8* src = dest + used - dist;
+            u8* dest_at = dest + used;
+            umm index = 0;
+            if (dist >= 8) {
+                for (; index + 8 <= length; index += 8) {
+                    memcpy(dest_at + index, src + index, 8);
+                }
+            } else if (dist >= 4) {
+                for (; index + 4 <= length; index += 4) {
+                    memcpy(dest_at + index, src + index, 4);
+                }
+            }
+            for (; index < length; index++) {
+                dest_at[index] = src[index];
+            }
+            used += length;
+        }
+    }
+    
+    state->dest_used = used;
+    return state->overrun_bits <= state->bit_count;
+}
+
+bool
+inflate_fixed_block(Inflate_State* state) {
+    static Inflate_Huffman lengths;
+    static Inflate_Huffman distances;
+    static bool is_initialized = false;
+    if (!is_initialized) {
+        u8 code_lengths[288];
+        for (int symbol = 0; symbol < 144; symbol++) code_lengths[symbol] = 8;
+        for (int symbol = 144; symbol < 256; symbol++) code_lengths[symbol] = 9;
+        for (int symbol = 256; symbol < 280; symbol++) code_lengths[symbol] = 7;
+        for (int symbol = 280; symbol < 288; symbol++) code_lengths[symbol] = 8;
+        build_inflate_huffman(&lengths, code_lengths, 288);
+        
+        for (int symbol = 0; symbol < 30; symbol++) code_lengths[symbol] = 5;
+        build_inflate_huffman(&distances, code_lengths, 30);
+        is_initialized = true;
+    }
+    
+    return inflate_codes(state, &lengths, &distances);
+}
+
+bool
+inflate_dynamic_block(Inflate_State* state) {
+    // NOTE(Alexander): the code length code lengths are stored in this order
+    static const u8 order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+    
+    int length_count = inflate_bits(state, 5) + 257;
+    int dist_count = inflate_bits(state, 5) + 1;
+    int code_count = inflate_bits(state, 4) + 4;
+    if (length_count > 286 || dist_count > 30) {
+        return false;
+    }
+    
+    u8 code_lengths[288 + 32] = {};
+    for (int index = 0; index < code_count; index++) {
+        code_lengths[order[index]] = (u8) inflate_bits(state, 3);
+    }
+    
+    Inflate_Huffman lengths;
+    Inflate_Huffman distances;
+    if (!build_inflate_huffman(&lengths, code_lengths, 19)) {
+        return false;
+    }
+    
+    int index = 0;
+    while (index < length_count + dist_count) {
+        s32 symbol = inflate_decode(state, &lengths);
+        if (symbol < 0) {
+            return false;
+        }
+        
+        if (symbol < 16) {
+            code_lengths[index++] = (u8) symbol;
+            continue;
+        }
+        
+        u8 length = 0;
+        int repeat = 0;
+        if (symbol == 16) {
+            if (index == 0) {
+                return false;
+            }
+            length = code_lengths[index - 1];
+            repeat = 3 + inflate_bits(state, 2);
+        } else if (symbol == 17) {
+            repeat = 3 + inflate_bits(state, 3);
+        } else {
+            repeat = 11 + inflate_bits(state, 7);
+        }
+        
+        if (index + repeat > length_count + dist_count) {
+            return false;
+        }
+        while (repeat--) {
+            code_lengths[index++] = length;
+        }
+    }
+    
+    if (code_lengths[256] == 0 ||
+        !build_inflate_huffman(&lengths, code_lengths, length_count) ||
+        !build_inflate_huffman(&distances, code_lengths + length_count, dist_count)) {
+        return false;
+    }
+    
+    return inflate_codes(state, &lengths, &distances);
+}
+
+// NOTE(Alexander): decodes a raw DEFLATE stream, returns the number of bytes written to dest
+// or -1 if the stream is corrupt or doesn't fit. The input size is returned in src_used.
+smm
+inflate(u8* dest, umm dest_size, u8* src, umm src_size, umm* src_used=0) {
+    Inflate_State state = {};
+    state.at = src;
+    state.end = src + src_size;
+    state.dest = dest;
+    state.dest_size = dest_size;
+    
+    bool is_last_block = false;
+    while (!is_last_block) {
+        is_last_block = inflate_bits(&state, 1) != 0;
+        u32 type = inflate_bits(&state, 2);
+        
+        bool ok = false;
+        if (type == 0) {
+            // NOTE(Alexander): stored block, skip to the next byte boundary and copy
+            inflate_bits(&state, state.bit_count & 7);
+            u32 length = inflate_bits(&state, 16);
+            u32 inverted_length = inflate_bits(&state, 16);
+            
+            // Hand the whole bytes left in the bit buffer back to the input
+            if (state.overrun_bits > state.bit_count) {
+                return -1;
+            }
+            state.at -= (state.bit_count - state.overrun_bits) / 8;
+            state.bit_buffer = 0;
+            state.bit_count = 0;
+            state.overrun_bits = 0;
+            
+            ok = (length ^ 0xFFFF) == inverted_length &&
+                length <= (umm) (state.end - state.at) &&
+                length <= state.dest_size - state.dest_used;
+            if (ok) {
+                memcpy(state.dest + state.dest_used, state.at, length);
+                state.dest_used += length;
+                state.at += length;
+            }
+            
+        } else if (type == 1) {
+            ok = inflate_fixed_block(&state);
+        } else if (type == 2) {
+            ok = inflate_dynamic_block(&state);
+        }
+        
+        if (!ok || state.overrun_bits > state.bit_count) {
+            return -1;
+        }
+    }
+    
+    if (src_used) {
+        *src_used = (umm) (state.at - src) - (state.bit_count - state.overrun_bits) / 8;
+    }
+    return (smm) state.dest_used;
+}
+
+u32
+adler32(u8* data, umm size) {
+    u32 a = 1;
+    u32 b = 0;
+    while (size > 0) {
+        // NOTE(Alexander): 5552 is the most bytes that can be summed before b overflows
+        umm block_size = min(size, (umm) 5552);
+        for (umm index = 0; index < block_size; index++) {
+            a += data[index];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += block_size;
+        size -= block_size;
+    }
+    return (b << 16) | a;
+}
+
+// NOTE(Alexander): slicing by 4, each of the extra tables advances the crc of a byte
+// one more position so four bytes can be folded in with independent lookups.
+u32
+crc32(u8* data, umm size) {
+    static u32 table[4][256];
+    static bool is_initialized = false;
+    if (!is_initialized) {
+        for (u32 index = 0; index < 256; index++) {
+            u32 crc = index;
+            for (int bit_index = 0; bit_index < 8; bit_index++) {
+                crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+            }
+            table[0][index] = crc;
+        }
+        for (u32 index = 0; index < 256; index++) {
+            for (int slice = 1; slice < 4; slice++) {
+                u32 prev = table[slice - 1][index];
+                table[slice][index] = table[0][prev & 0xFF] ^ (prev >> 8);
+            }
+        }
+        is_initialized = true;
+    }
+    
+    u32 crc = 0xFFFFFFFFu;
+    umm index = 0;
+    for (; index + 4 <= size; index += 4) {
+        crc ^= (u32) data[index] | ((u32) data[index + 1] << 8) | 
+            ((u32) data[index + 2] << 16) | ((u32) data[index + 3] << 24);
+        crc = (table[3][crc & 0xFF] ^ table[2][(crc >> 8) & 0xFF] ^ 
+               table[1][(crc >> 16) & 0xFF] ^ table[0][crc >> 24]);
+    }
+    for (; index < size; index++) {
+        crc = table[0][(crc ^ data[index]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// NOTE(Alexander): a zlib stream is a two byte header, the DEFLATE data and a big endian
+// adler32 of the uncompressed data. Returns the decompressed size or -1.
+smm
+zlib_decompress(u8* dest, umm dest_size, u8* src, umm src_size) {
+    if (src_size < 6) {
+        return -1;
+    }
+    
+    u8 method = src[0];
+    u8 flags = src[1];
+    if ((method & 0x0F) != 8 || (method >> 4) > 7 || ((method << 8) | flags) % 31 != 0 || (flags & 0x20)) {
+        return -1; // NOTE(Alexander): not deflate or needs a preset dictionary
+    }
+    
+    umm used = 0;
+    smm result = inflate(dest, dest_size, src + 2, src_size - 6, &used);
+    if (result < 0) {
+        return -1;
+    }
+    
+    u8* checksum = src + 2 + used;
+    u32 expected = ((u32) checksum[0] << 24) | ((u32) checksum[1] << 16) | ((u32) checksum[2] << 8) | checksum[3];
+    return adler32(dest, (umm) result) == expected ? result : -1;
+}
+
+// NOTE(Alexander): a gzip member is a header of at least 10 bytes, the DEFLATE data,
+// a crc32 and the uncompressed size. Returns the decompressed size or -1.
+smm
+gzip_decompress(u8* dest, umm dest_size, u8* src, umm src_size) {
+    if (src_size < 18 || src[0] != 0x1F || src[1] != 0x8B || src[2] != 8) {
+        return -1;
+    }
+    
+    u8 flags = src[3];
+    u8* at = src + 10;
+    u8* end = src + src_size - 8;
+    if (flags & 0x04) { // FEXTRA
+        if (end - at < 2) return -1;
+        umm extra_size = at[0] | (at[1] << 8);
+        at += 2;
+        if ((umm) (end - at) < extra_size) return -1;
+        at += extra_size;
+    }
+    if (flags & 0x08) { // FNAME
+        at = find_byte(at, end, 0) + 1;
+    }
+    if (flags & 0x10) { // FCOMMENT
+        at = find_byte(at, end, 0) + 1;
+    }
+    if (flags & 0x02) { // FHCRC
+        at += 2;
+    }
+    if (at > end) {
+        return -1;
+    }
+    
+    umm used = 0;
+    smm result = inflate(dest, dest_size, at, (umm) (end - at), &used);
+    if (result < 0) {
+        return -1;
+    }
+    
+    u8* trailer = at + used;
+    u32 expected_crc = trailer[0] | (trailer[1] << 8) | (trailer[2] << 16) | ((u32) trailer[3] << 24);
+    u32 expected_size = trailer[4] | (trailer[5] << 8) | (trailer[6] << 16) | ((u32) trailer[7] << 24);
+    if ((u32) result != expected_size || crc32(dest, (umm) result) != expected_crc) {
+        return -1;
+    }
+    return result;
+}
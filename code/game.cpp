@@ -1,13 +1,23 @@
 
+#ifndef HEADLESS
+#define HEADLESS 0
+#endif
+
 #define BACKGROUND_COLOR BLACK
 #define TILE_SIZE 16
 #define GRAVITY 10
 #define JUMP_VELOCITY -14
+#define BAKE_TILE_COLLIDERS 1
+#define CACHE_TILE_CHUNKS 1
+#define SIM_HZ 60
+#define MAX_FRAME_TIME 0.25f
 
 #include "game.h"
 
 #include "particles.cpp"
+#include "format_zlib.cpp"
 #include "format_tmx.cpp"
+#include "format_level.cpp"
 #include "physics.cpp"
 #include "draw.cpp"
 
@@ -19,100 +29,104 @@ const Entity_Type gid_to_entity_type[] = {
 
 void
 configure_entity(Game_State* game, Entity* entity) {
+    Box* collider = get_entity_collider(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    Entity_Render* render = get_entity_render(game, entity);
+    Entity_Cold* cold = get_entity_cold(game, entity);
     switch (entity->type) {
         case Player: {
-            entity->size = vec2(0.6f, 1.25f);
-            entity->health = 1;
+            collider->size = vec2(0.6f, 1.25f);
+            cold->health = 1;
             entity->offset.x = -0.1f;
-            entity->is_rigidbody = true;
+            flags->is_rigidbody = true;
             entity->max_speed.x = 5.0f;
             entity->max_speed.y = 20.0f;
-            entity->frame_duration = 2.0f;
-            entity->frames = 6;
-            if (!entity->invert_gravity) {
-                entity->p.y -= entity->size.y - 1.0f;
+            render->frame_duration = 2.0f;
+            render->frames = 6;
+            if (!flags->invert_gravity) {
+                collider->p.y -= collider->size.y - 1.0f;
             }
-            entity->sprite = &game->texture_character;
-            entity->prev_invert_gravity = entity->invert_gravity;
+            render->sprite = &game->sprite_character;
+            entity->prev_invert_gravity = flags->invert_gravity;
             game->player = entity;
         } break;
         
         case Coin: {
-            entity->sprite = &game->texture_coin;
-            entity->frames = 8;
-            entity->frame_duration = 0.1f;
-            entity->size = vec2(1.0f, 1.0f);
+            render->sprite = &game->sprite_coin;
+            render->frames = 8;
+            render->frame_duration = 0.1f;
+            collider->size = vec2(1.0f, 1.0f);
             entity->offset = {};
-            entity->is_trigger = true;
+            flags->is_trigger = true;
         } break;
         
         case Spikes: {
-            entity->sprite = &game->texture_spikes;
-            entity->size = vec2(1.0f, 1.0f);
-            entity->is_solid = true;
-            entity->invert_gravity = entity->direction.y < 0.0f;
+            render->sprite = &game->sprite_spikes;
+            collider->size = vec2(1.0f, 1.0f);
+            flags->is_solid = true;
+            flags->invert_gravity = entity->direction.y < 0.0f;
         } break;
         
         case Spikes_Top: {
-            entity->sprite = &game->texture_spikes;
-            entity->size = vec2(1.0f, 1.0f);
-            entity->is_solid = true;
+            render->sprite = &game->sprite_spikes;
+            collider->size = vec2(1.0f, 1.0f);
+            flags->is_solid = true;
         } break;
         
         case Enemy_Plum: {
-            entity->health = 1;
-            entity->sprite = &game->texture_plum;
+            cold->health = 1;
+            render->sprite = &game->sprite_plum;
             entity->max_speed.x = 2.0f;
             entity->max_speed.y = 10.0f;
-            entity->frames = 4;
-            entity->frame_duration = 0.12f;
+            render->frames = 4;
+            render->frame_duration = 0.12f;
             if (entity->direction.y < 0) {
-                entity->invert_gravity = true;
+                flags->invert_gravity = true;
             }
-            entity->size = vec2(1.0f, 1.0f);
-            entity->is_rigidbody = true;
+            collider->size = vec2(1.0f, 1.0f);
+            flags->is_rigidbody = true;
         } break;
         
         
         case Enemy_Sharpie: {
-            entity->health = 1;
-            entity->sprite = &game->texture_sharpie;
+            cold->health = 1;
+            render->sprite = &game->sprite_sharpie;
             entity->max_speed.x = 2.0f;
             entity->max_speed.y = 20.0f;
-            entity->frames = 4;
-            entity->frame_duration = 0.12f;
+            render->frames = 4;
+            render->frame_duration = 0.12f;
             if (entity->direction.y < 0) {
-                entity->invert_gravity = true;
+                flags->invert_gravity = true;
             }
-            entity->size = vec2(1.0f, 1.0f);
-            entity->is_rigidbody = true;
+            collider->size = vec2(1.0f, 1.0f);
+            flags->is_rigidbody = true;
         } break;
         
         case Vine: {
-            entity->sprite = &game->texture_vine;
-            entity->size = vec2(1.0f, 1.0f);
+            render->sprite = &game->sprite_vine;
+            collider->size = vec2(1.0f, 1.0f);
             if (entity->direction.y < 0) {
                 entity->offset.y = -1.0f;
-                entity->collision_mask = Col_Top;
+                cold->collision_mask = Col_Top;
             } else {
                 entity->offset.y = 1.0f;
-                entity->collision_mask = Col_Bottom;
+                cold->collision_mask = Col_Bottom;
             }
         } break;
         
         case Gravity_Normal:
         case Gravity_Inverted: {
-            entity->layer = Layer_Background;
-            entity->sprite = &game->texture_space;
-            entity->size = vec2(1.0f, 1.0f);
+            render->layer = Layer_Background;
+            render->sprite = &game->sprite_space;
+            collider->size = vec2(1.0f, 1.0f);
             entity->offset.y += entity->type == Gravity_Inverted ? -0.2f : 0.2f;
-            entity->is_trigger = true;
-            entity->is_solid = false;
+            flags->is_trigger = true;
+            flags->is_solid = false;
         } break;
     }
 }
 
-int
+Tile
 get_tile(Game_State* game, int x, int y) {
     if (x >= 0 && y >= 0 && x < game->tile_map_width && y < game->tile_map_height) {
         return game->tile_map[y*game->tile_map_width + x];
@@ -121,21 +135,24 @@ get_tile(Game_State* game, int x, int y) {
 }
 
 struct Surround_Tiles {
-    int left;
-    int middle;
-    int right;
+    Tile left;
+    Tile middle;
+    Tile right;
 };
 
 Surround_Tiles
 get_floor_tiles(Game_State* game, Entity* entity, f32 range=0.5f) {
+    Box* collider = get_entity_collider(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
     int y_under;
-    if (entity->invert_gravity) {
-        y_under = (int) (entity->p.y - 0.2f);
+    if (flags->invert_gravity) {
+        y_under = (int) (collider->p.y - 0.2f);
     } else {
-        y_under = (int) (entity->p.y + entity->size.y + 0.2f);
+        y_under = (int) (collider->p.y + collider->size.y + 0.2f);
     }
     
-    f32 mid = entity->p.x + entity->size.x/2.0f;
+    f32 mid = collider->p.x + collider->size.x/2.0f;
     Surround_Tiles result = {};
     result.left = get_tile(game, (int) (mid - range), y_under);
     result.middle = get_tile(game, (int) mid, y_under);
@@ -147,23 +164,25 @@ void
 save_game_state(Game_State* game) {
     game->saved_coins = game->coins;
     game->saved_finished_tutorials = game->finished_tutorials;
-    for_array(game->entities, entity, i) {
+    for (int i = 0; i < game->entity_count; i++) {
+        Entity* entity = &game->entities[i];
+        Box* collider = &game->entity_colliders[i];
         Saved_Entity* saved_entity = &game->saved_entities[i];
         saved_entity->type = entity->type;
-        saved_entity->p = entity->p;
+        saved_entity->p = collider->p;
         saved_entity->direction = entity->direction;
         if (saved_entity->type == Player) {
             
             Surround_Tiles s = get_floor_tiles(game, entity);
             if (s.middle) {
-                saved_entity->p.x = ((int) entity->p.x) + 0.2f;
+                saved_entity->p.x = ((int) collider->p.x) + 0.2f;
             } else if (s.left) {
-                saved_entity->p.x = ((int) entity->p.x - 1) + 0.2f;
+                saved_entity->p.x = ((int) collider->p.x - 1) + 0.2f;
             } else if (s.right) {
-                saved_entity->p.x = ((int) entity->p.x + 1) + 0.2f;
+                saved_entity->p.x = ((int) collider->p.x + 1) + 0.2f;
             }
         }
-        saved_entity->invert_gravity = entity->invert_gravity;
+        saved_entity->invert_gravity = game->entity_flags[i].invert_gravity;
     }
 }
 
@@ -172,22 +191,34 @@ restore_game_state(Game_State* game) {
     game->coins = game->saved_coins;
     game->curr_tutorials = 0;
     game->saved_finished_tutorials = game->finished_tutorials;
-    for_array(game->entities, entity, i) {
+    for (int i = 0; i < game->entity_count; i++) {
+        Entity* entity = clear_entity(game, i);
         Saved_Entity* saved_entity = &game->saved_entities[i];
-        *entity = {};
+        Box* collider = &game->entity_colliders[i];
         entity->type = saved_entity->type;
-        entity->p = saved_entity->p;
+        collider->p = saved_entity->p;
         entity->direction = saved_entity->direction;
-        entity->invert_gravity = saved_entity->invert_gravity;
+        game->entity_flags[i].invert_gravity = saved_entity->invert_gravity;
         configure_entity(game, entity);
+        game->entity_renders[i].prev_p = collider->p;
+    }
+}
+
+Entity_Type
+get_entity_type_from_gid(s32 gid) {
+    s32 index = (gid & (bit(30) - 1)) - first_gid;
+    if (index >= 0 && index < fixed_array_count(gid_to_entity_type)) {
+        return gid_to_entity_type[index];
     }
+    return None;
 }
 
 Entity*
 convert_tmx_object_to_entity(Game_State* game, Tmx_Object* object) {
-    Entity* entity = add_entity(game, None);
-    entity->p = object->p;
-    entity->size = object->size;
+    Entity* entity = add_entity(game, get_entity_type_from_gid(object->gid));
+    Box* collider = get_entity_collider(game, entity);
+    collider->p = object->p;
+    collider->size = object->size;
     
     entity->direction.x = (object->gid & bit(31)) ? -1.0f : 1.0f;
     entity->direction.y = (object->gid & bit(30)) ? -1.0f : 1.0f;
@@ -195,20 +226,20 @@ convert_tmx_object_to_entity(Game_State* game, Tmx_Object* object) {
     
     s32 index = object->gid - first_gid;
     if (index >= 0 && index < fixed_array_count(gid_to_entity_type)) {
-        entity->type = gid_to_entity_type[index];
-        
         if (entity->type == Coin) {
             game->max_coins++;
         }
         
         if (object->gid == player_inverted_gid) {
-            entity->invert_gravity = true;
+            get_entity_flags(game, entity)->invert_gravity = true;
         }
         configure_entity(game, entity);
+        get_entity_render(game, entity)->prev_p = collider->p;
         
         if (object->name.data) {
-            entity->tag = &object->name;
-            pln("TAG: %.*s", (int) entity->tag->count, entity->tag->data);
+            Entity_Cold* cold = get_entity_cold(game, entity);
+            cold->tag = &object->name;
+            pln("TAG: %.*s", (int) cold->tag->count, cold->tag->data);
         }
     } else {
         pln("warning: unknown object (gid=%d) at %f, %f", object->gid, object->p.x, object->p.y);
@@ -217,23 +248,72 @@ convert_tmx_object_to_entity(Game_State* game, Tmx_Object* object) {
     return entity;
 }
 
+// NOTE(Alexander): gives each entity type a contiguous range of entities, in enum order,
+// and allocates the entity arrays to fit all of them.
+void
+reserve_entity_ranges(Game_State* game, Memory_Arena* arena, int* type_counts) {
+    game->entity_count = 0;
+    game->spawned_entity_count = 0;
+    for (int type = 0; type < Entity_Type_Count; type++) {
+        game->entity_ranges[type].first = game->entity_count;
+        game->entity_ranges[type].count = 0;
+        game->entity_ranges[type].max_count = type_counts[type];
+        game->entity_count += type_counts[type];
+    }
+    
+    game->entities = push_array_of_structs(arena, game->entity_count, Entity);
+    game->entity_colliders = push_array_of_structs(arena, game->entity_count, Box);
+    game->entity_velocities = push_array_of_structs(arena, game->entity_count, v2);
+    game->entity_accelerations = push_array_of_structs(arena, game->entity_count, v2);
+    game->entity_flags = push_array_of_structs(arena, game->entity_count, Entity_Flags);
+    game->entity_renders = push_array_of_structs(arena, game->entity_count, Entity_Render);
+    game->entity_colds = push_array_of_structs(arena, game->entity_count, Entity_Cold);
+    game->saved_entities = push_array_of_structs(arena, game->entity_count, Saved_Entity);
+    game->entity_spawn_order = push_array_of_structs(arena, game->entity_count, s32);
+}
+
 void
 game_setup_level(Game_State* game, Memory_Arena* level_arena, string filename) {
     clear(level_arena);
+    game->level_arena = level_arena;
     game->entity_count = 0;
+    game->colliders = 0;
     game->collider_count = 0;
+    game->max_collider_count = 0;
     game->trigger_count = 0;
+    game->max_trigger_count = 0;
     game->checkpoint_count = 0;
+    game->max_checkpoint_count = 0;
+    game->player = 0;
     
-    memset(game->entities, 0, sizeof(game->entities));
-    memset(game->colliders, 0, sizeof(game->colliders));
-    memset(game->triggers, 0, sizeof(game->triggers));
-    memset(game->checkpoints, 0, sizeof(game->checkpoints));
-    
-    Loaded_Tmx tmx = read_tmx_map_data(filename, level_arena);
+    Loaded_Tmx tmx = read_level(filename, level_arena);
     game->tile_map = tmx.tile_map;
     game->tile_map_width = tmx.tile_map_width;
     game->tile_map_height = tmx.tile_map_height;
+    game->solid_tiles = tmx.solid_tiles;
+    game->solid_tile_count = tmx.solid_tile_count;
+    invalidate_tile_chunks(game);
+    
+    // NOTE(Alexander): size the level pools from the objects in the map
+    int type_counts[Entity_Type_Count] = {};
+    int max_collider_count = 0;
+    for (int object_index = 0; object_index < tmx.object_count; object_index++) {
+        Tmx_Object* object = &tmx.objects[object_index];
+        switch (object->group) {
+            case TmxObjectGroup_Entities: type_counts[get_entity_type_from_gid(object->gid)]++; break;
+            case TmxObjectGroup_Colliders: max_collider_count++; break;
+            case TmxObjectGroup_Triggers: game->max_trigger_count++; break;
+            case TmxObjectGroup_Checkpoints: game->max_checkpoint_count++; break;
+        }
+    }
+    
+    reserve_entity_ranges(game, level_arena, type_counts);
+    game->triggers = push_array_of_structs(level_arena, game->max_trigger_count, Trigger);
+    game->checkpoints = push_array_of_structs(level_arena, game->max_checkpoint_count, Box);
+    if (max_collider_count > 0) {
+        game->colliders = push_array_of_structs(level_arena, max_collider_count, Box, PushFlag_NoClear);
+        game->max_collider_count = max_collider_count;
+    }
     
     for (int object_index = 0; object_index < tmx.object_count; object_index++) {
         Tmx_Object* object = &tmx.objects[object_index];
@@ -256,43 +336,65 @@ game_setup_level(Game_State* game, Memory_Arena* level_arena, string filename) {
         }
     }
     
+    // NOTE(Alexander): levels without hand-placed colliders collide with the tiles instead
+    game->use_tile_collision = false;
+    if (game->collider_count == 0) {
+#if BAKE_TILE_COLLIDERS
+        bake_tile_colliders(game, level_arena);
+#else
+        game->use_tile_collision = true;
+#endif
+    }
+    
+    init_spatial_grid(game, level_arena);
+    update_spatial_grid(game);
+    
     assert(game->player);
     save_game_state(game);
+    
+    game->prev_camera_p = game->camera_p;
+    game->snap_camera = true;
 }
 
 void
-kill_entity(Entity* entity) {
-    entity->health = 0;
+kill_entity(Game_State* game, Entity* entity) {
+    get_entity_cold(game, entity)->health = 0;
 }
 
 void
 update_player(Game_State* game, Entity* player, Game_Controller* controller) {
+    Box* collider = get_entity_collider(game, player);
+    v2* velocity = get_entity_velocity(game, player);
+    v2* acceleration = get_entity_acceleration(game, player);
+    Entity_Flags* flags = get_entity_flags(game, player);
+    
     const f32 gravity = game->normal_gravity;
     const f32 fall_gravity = game->fall_gravity;
     const f32 jump_velocity = -14;
     f32 gravity_sign = 1;
-    if (player->invert_gravity) {
+    if (flags->invert_gravity) {
         gravity_sign = -1;
     }
     
     // Jump
-    if (player->is_grounded && controller->jump_pressed) {
-        player->velocity.y = jump_velocity*gravity_sign;
-        player->is_jumping = true;
+    if (flags->is_grounded && controller->jump_pressed) {
+        velocity->y = jump_velocity*gravity_sign;
+        flags->is_jumping = true;
     }
-    if (!controller->jump_down || player->velocity.y*gravity_sign >= 0.0f) {
-        player->is_jumping = false;
+    if (!controller->jump_down || velocity->y*gravity_sign >= 0.0f) {
+        flags->is_jumping = false;
     }
     
     // Invert gravity
     if (controller->action_pressed && 
-        player->prev_invert_gravity == player->invert_gravity && 
+        player->prev_invert_gravity == flags->invert_gravity && 
         game->ability_unlock_gravity) {
         
         PlaySound(game->snd_gravity_switch);
-        player->invert_gravity = !player->invert_gravity;
-        player->velocity.y = -7*gravity_sign;
-        player->is_grounded = false;
+        spawn_particle_effect(game->particles, game->emitter_gravity_switch, collider->p + collider->size*0.5f, 16);
+        flags->invert_gravity = !flags->invert_gravity;
+        velocity->y = -7*gravity_sign;
+        flags->is_grounded = false;
     }
     
     // TODO(Alexander): must have!
@@ -300,89 +402,90 @@ update_player(Game_State* game, Entity* player, Game_Controller* controller) {
     // Add jump buffering
     
     // Gravity
-    player->acceleration.y = gravity*gravity_sign;
-    if (!player->is_jumping && !player->is_grounded) {
-        player->acceleration.y = fall_gravity*gravity_sign;
+    acceleration->y = gravity*gravity_sign;
+    if (!flags->is_jumping && !flags->is_grounded) {
+        acceleration->y = fall_gravity*gravity_sign;
     }
     
     // Walking
     if (fabsf(controller->dir.x) > 0.3f) {
         player->direction.x = controller->dir.x;
-        player->acceleration.x = controller->dir.x * 20.0f;
+        acceleration->x = controller->dir.x * 20.0f;
         if (game->is_moon_gravity) {
-            player->acceleration.x = controller->dir.x * 2.0f;
+            acceleration->x = controller->dir.x * 2.0f;
         }
     } else {
-        player->acceleration.x = 0.0f;
+        acceleration->x = 0.0f;
     }
     
     // Run physics
     update_rigidbody(game, player);
     
     // Check collisions with entites
-    if (player->collided_with) {
-        Entity* other = player->collided_with;
+    Entity* other = get_entity_cold(game, player)->collided_with;
+    if (other) {
         switch (other->type) {
             case Spikes:
             case Spikes_Top: {
                 if (player->collision & (Col_Top | Col_Bottom)) {
-                    kill_entity(player);
+                    kill_entity(game, player);
                 }
             } break;
             
             case Enemy_Plum: {
-                if (!player->is_grounded && 
-                    ((!other->invert_gravity && player->collision & Col_Bottom) ||
-                     (other->invert_gravity && player->collision & Col_Top))) {
-                    kill_entity(other);
+                if (!flags->is_grounded && 
+                    ((!get_entity_flags(game, other)->invert_gravity && player->collision & Col_Bottom) ||
+                     (get_entity_flags(game, other)->invert_gravity && player->collision & Col_Top))) {
+                    kill_entity(game, other);
                     PlaySound(game->snd_plum_death);
+                    spawn_particle_effect(game->particles, game->emitter_plum_death, get_entity_collider(game, other)->p + get_entity_collider(game, other)->size*0.5f, 20);
                     // bounce
                     if (controller->jump_down) {
-                        player->velocity.y = jump_velocity*gravity_sign;
-                        player->is_jumping = true;
+                        velocity->y = jump_velocity*gravity_sign;
+                        flags->is_jumping = true;
                     } else {
-                        player->velocity.y = jump_velocity/2.0f*gravity_sign;
+                        velocity->y = jump_velocity/2.0f*gravity_sign;
                     }
                 } else {
-                    kill_entity(player);
+                    kill_entity(game, player);
                 }
             } break;
             
             case Enemy_Sharpie: {
-                kill_entity(player);
+                kill_entity(game, player);
             } break;
             
             case Coin: {
                 other->type = None;
                 game->coins++;
                 PlaySound(game->snd_pickup_moon);
+                spawn_particle_effect(game->particles, game->emitter_coin, get_entity_collider(game, other)->p + get_entity_collider(game, other)->size*0.5f, 12);
             } break;
             
             case Gravity_Normal: {
-                if (player->invert_gravity) {
+                if (flags->invert_gravity) {
                     PlaySound(game->snd_gravity_switch);
+                    spawn_particle_effect(game->particles, game->emitter_gravity_switch, collider->p + collider->size*0.5f, 16);
                 }
-                player->invert_gravity = false;
+                flags->invert_gravity = false;
             } break;
             
             case Gravity_Inverted: {
-                if (!player->invert_gravity) {
+                if (!flags->invert_gravity) {
                     PlaySound(game->snd_gravity_switch);
+                    spawn_particle_effect(game->particles, game->emitter_gravity_switch, collider->p + collider->size*0.5f, 16);
                 }
-                player->invert_gravity = true;
+                flags->invert_gravity = true;
             } break;
         }
     }
     
-    if (player->is_grounded && !player->collided_with && player->health > 0) {
+    if (flags->is_grounded && !other && get_entity_cold(game, player)->health > 0) {
         // Save restore point (within checkpoint regions)
         bool is_within_checkpoint = false;
-        for_array(game->checkpoints, checkpoint, checkpoint_index) {
-            if (checkpoint_index >= game->checkpoint_count) {
-                break;
-            }
-            
-            if (box_check(player->collider, *checkpoint)) {
+        for (int checkpoint_index = 0; checkpoint_index < game->checkpoint_count; checkpoint_index++) {
+            Box* checkpoint = &game->checkpoints[checkpoint_index];
+            if (box_check(*collider, *checkpoint)) {
                 is_within_checkpoint = true;
                 break;
             }
@@ -392,14 +495,15 @@ update_player(Game_State* game, Entity* player, Game_Controller* controller) {
         if (is_within_checkpoint) {
             // Make sure we don't save next to an enemy and soft lock the game
             bool is_nearby_enemy = false;
-            for_array(game->entities, other, _2) {
+            for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
+                Entity* other = &game->entities[entity_index];
                 if (other->type == Enemy_Plum ||
                     other->type == Enemy_Sharpie) {
-                    Box area = other->collider;
+                    Box area = *get_entity_collider(game, other);
                     area.p -= 5.0f;
                     area.size += 10.0f;
                     
-                    if (box_check(player->collider, area)) {
+                    if (box_check(*collider, area)) {
                         is_nearby_enemy = true;
                     }
                 }
@@ -412,10 +516,10 @@ update_player(Game_State* game, Entity* player, Game_Controller* controller) {
     }
     
     // Check triggers
-    if (player->is_grounded && player->health > 0) {
-        for_array(game->triggers, trigger, trigger_index) {
-            if (trigger_index >= game->trigger_count) break;
-            bool overlap = box_check(player->collider, trigger->collider);
+    if (flags->is_grounded && get_entity_cold(game, player)->health > 0) {
+        for (int trigger_index = 0; trigger_index < game->trigger_count; trigger_index++) {
+            Trigger* trigger = &game->triggers[trigger_index];
+            bool overlap = box_check(*collider, trigger->collider);
             if (string_equals(trigger->tag, string_lit("tutorial_walk"))) {
                 update_tutorial(game, overlap, Tutorial_Walk);
             }
@@ -460,15 +564,18 @@ update_player(Game_State* game, Entity* player, Game_Controller* controller) {
 
 void
 update_enemy_plum(Game_State* game, Entity* entity) {
-    if (entity->health <= 0) {
+    v2* acceleration = get_entity_acceleration(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
+    if (get_entity_cold(game, entity)->health <= 0) {
         entity->type = Enemy_Plum_Dead;
-        entity->sprite = &game->texture_plum_dead;
-        entity->is_rigidbody = false;
+        get_entity_render(game, entity)->sprite = &game->sprite_plum_dead;
+        flags->is_rigidbody = false;
         return;
     }
     
     f32 gravity_sign = 1;
-    if (entity->invert_gravity) {
+    if (flags->invert_gravity) {
         gravity_sign = -1;
     }
     
@@ -476,33 +583,33 @@ update_enemy_plum(Game_State* game, Entity* entity) {
         entity->direction.x = -1.0f;
     }
     
-    if (entity->is_grounded) {
-        entity->acceleration.x = 5.0f * entity->direction.x;
+    if (flags->is_grounded) {
+        acceleration->x = 5.0f * entity->direction.x;
     }
-    entity->acceleration.y = game->fall_gravity * gravity_sign;
+    acceleration->y = game->fall_gravity * gravity_sign;
     
     // Run physics
     update_rigidbody(game, entity);
     
-    if (entity->is_grounded) {
+    if (flags->is_grounded) {
         Surround_Tiles s = get_floor_tiles(game, entity, 1.0f);
         if (!s.left) entity->direction.x = 1.0f;
         if (!s.right) entity->direction.x = -1.0f;
     }
     
-    if (entity->collided_with) {
-        Entity* other = entity->collided_with;
+    Entity* other = get_entity_cold(game, entity)->collided_with;
+    if (other) {
         switch (other->type) {
             case Player: {
-                kill_entity(other);
+                kill_entity(game, other);
             } break;
             
             case Gravity_Normal: {
-                entity->invert_gravity = false;
+                flags->invert_gravity = false;
             } break;
             
             case Gravity_Inverted: {
-                entity->invert_gravity = true;
+                flags->invert_gravity = true;
             } break;
         }
     }
@@ -517,27 +624,34 @@ update_enemy_plum(Game_State* game, Entity* entity) {
 
 void
 update_enemy_sharpie(Game_State* game, Entity* entity) {
-    if (entity->health <= 0) {
+    Box* collider = get_entity_collider(game, entity);
+    v2* velocity = get_entity_velocity(game, entity);
+    v2* acceleration = get_entity_acceleration(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
+    if (get_entity_cold(game, entity)->health <= 0) {
         //entity->type = Enemy_Plum_Dead;
-        //entity->sprite = &game->texture_plum_dead;
-        entity->is_rigidbody = false;
+        //entity->sprite = &game->sprite_plum_dead;
+        flags->is_rigidbody = false;
         return;
     }
     
     f32 gravity_sign = 1;
-    if (entity->invert_gravity) {
+    if (flags->invert_gravity) {
         gravity_sign = -1;
     }
     
     // Invert gravity to attack the player (within attack range)
-    f32 x_diff = (game->player->p.x - entity->p.x)*entity->direction.x;
-    if (entity->invert_gravity == entity->prev_invert_gravity &&
-        fabsf(game->player->p.y - entity->p.y) > 2.0f &&
+    Box* player_collider = get_entity_collider(game, game->player);
+    Entity_Flags* player_flags = get_entity_flags(game, game->player);
+    f32 x_diff = (player_collider->p.x - collider->p.x)*entity->direction.x;
+    if (flags->invert_gravity == entity->prev_invert_gravity &&
+        fabsf(player_collider->p.y - collider->p.y) > 2.0f &&
         x_diff > 0.0f && x_diff < 3.0f) {
         
-        if (entity->invert_gravity != game->player->invert_gravity) {
-            entity->invert_gravity = game->player->invert_gravity;
-            entity->velocity.y = -7*gravity_sign;
+        if (flags->invert_gravity != player_flags->invert_gravity) {
+            flags->invert_gravity = player_flags->invert_gravity;
+            velocity->y = -7*gravity_sign;
         }
     }
     
@@ -545,27 +659,27 @@ update_enemy_sharpie(Game_State* game, Entity* entity) {
         entity->direction.x = -1.0f;
     }
     
-    if (entity->is_grounded) {
-        entity->acceleration.x = 5.0f * entity->direction.x;
+    if (flags->is_grounded) {
+        acceleration->x = 5.0f * entity->direction.x;
     }
-    entity->acceleration.y = game->fall_gravity * gravity_sign;
+    acceleration->y = game->fall_gravity * gravity_sign;
     
     // Run physics
     update_rigidbody(game, entity);
     
-    if (entity->collided_with) {
-        Entity* other = entity->collided_with;
+    Entity* other = get_entity_cold(game, entity)->collided_with;
+    if (other) {
         switch (other->type) {
             case Player: {
-                kill_entity(other);
+                kill_entity(game, other);
             } break;
             
             case Gravity_Normal: {
-                entity->invert_gravity = false;
+                flags->invert_gravity = false;
             } break;
             
             case Gravity_Inverted: {
-                entity->invert_gravity = true;
+                flags->invert_gravity = true;
             } break;
         }
     }
@@ -576,13 +690,27 @@ update_enemy_sharpie(Game_State* game, Entity* entity) {
         entity->direction.x = -1.0f;
     }
     
-    entity->size = vec2(1.0f, 1.0f);
+    collider->size = vec2(1.0f, 1.0f);
 }
 
+#define VIEW_MARGIN 2.0f
+
 void
 render_level(Game_State* game, bool skip_enemies=false, bool skip_tilemap=false) {
-    for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
-        Entity* entity = &game->entities[entity_index];
+    // NOTE(Alexander): only entities in the grid cells around the camera are drawn,
+    // the query result is sorted by spawn id so they are drawn in the level order.
+    Box view;
+    view.p = game->camera_p - VIEW_MARGIN;
+    view.size = vec2((f32) game->game_width, (f32) game->game_height) + 2.0f*VIEW_MARGIN;
+    
+    Spatial_Grid* grid = &game->grid;
+    s32* visible = push_frame_array(game, game->entity_count, s32);
+    int visible_count = query_spatial_grid(grid, grid->dynamic_cells, grid->dynamic_entries, view,
+                                           visible, game->entity_count);
+    
+    begin_sprite_batch(game, visible_count);
+    for (int visible_index = 0; visible_index < visible_count; visible_index++) {
+        Entity* entity = get_entity_by_spawn_id(game, visible[visible_index]);
         
         if (skip_tilemap && (entity->type == Gravity_Normal ||
                              entity->type == Gravity_Inverted)) {
@@ -591,13 +719,15 @@ render_level(Game_State* game, bool skip_enemies=false, bool skip_tilemap=false)
         
         draw_entity(game, entity, Layer_Background);
     }
+    end_sprite_batch(game);
     
     if (!skip_tilemap) {
         draw_tilemap(game);
     }
     
-    for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
-        Entity* entity = &game->entities[entity_index];
+    begin_sprite_batch(game, visible_count);
+    for (int visible_index = 0; visible_index < visible_count; visible_index++) {
+        Entity* entity = get_entity_by_spawn_id(game, visible[visible_index]);
         
         if (skip_enemies && (entity->type == Enemy_Plum ||
                              entity->type == Enemy_Plum_Dead ||
@@ -608,12 +738,14 @@ render_level(Game_State* game, bool skip_enemies=false, bool skip_tilemap=false)
         
         draw_entity(game, entity, Layer_Entity);
     }
+    end_sprite_batch(game);
 }
 
 inline void
 center_camera_on_entity(Game_State* game, Entity* entity) {
-    game->camera_p.x = entity->p.x - game->game_width/2.0f;
-    game->camera_p.y = entity->p.y - game->game_height/2.0f;
+    Box* collider = get_entity_collider(game, entity);
+    game->camera_p.x = collider->p.x - game->game_width/2.0f;
+    game->camera_p.y = collider->p.y - game->game_height/2.0f;
 }
 
 inline f32
@@ -655,12 +787,13 @@ camera_lock_y_to_zero(Game_State* game) {
 
 void
 camera_follow_entity_x(Game_State* game, Entity* entity, f32 camera_max_offset=2) {
-    f32 camera_offset = game->camera_p.x - (entity->p.x - game->game_width/2.0f);
+    Box* collider = get_entity_collider(game, entity);
+    f32 camera_offset = game->camera_p.x - (collider->p.x - game->game_width/2.0f);
     if (camera_offset < -camera_max_offset) {
-        game->camera_p.x = entity->p.x - game->game_width/2.0f - camera_max_offset;
+        game->camera_p.x = collider->p.x - game->game_width/2.0f - camera_max_offset;
     }
     if (camera_offset > camera_max_offset) {
-        game->camera_p.x = entity->p.x - game->game_width/2.0f + camera_max_offset;
+        game->camera_p.x = collider->p.x - game->game_width/2.0f + camera_max_offset;
     }
     
     if (game->camera_p.x < 0) {
@@ -670,12 +803,13 @@ camera_follow_entity_x(Game_State* game, Entity* entity, f32 camera_max_offset=2
 
 void
 camera_follow_entity_y(Game_State* game, Entity* entity, f32 camera_max_offset=2) {
-    f32 camera_offset = game->camera_p.y - (entity->p.y - game->game_width/2.0f);
+    Box* collider = get_entity_collider(game, entity);
+    f32 camera_offset = game->camera_p.y - (collider->p.y - game->game_width/2.0f);
     if (camera_offset < -camera_max_offset) {
-        game->camera_p.y = entity->p.y - game->game_width/2.0f - camera_max_offset;
+        game->camera_p.y = collider->p.y - game->game_width/2.0f - camera_max_offset;
     }
     if (camera_offset > camera_max_offset) {
-        game->camera_p.y = entity->p.y - game->game_width/2.0f + camera_max_offset;
+        game->camera_p.y = collider->p.y - game->game_width/2.0f + camera_max_offset;
     }
     
     if (game->camera_p.y < 0) {
@@ -691,92 +825,179 @@ Color colors[] = {
     { 255, 238, 131, 255 }
 };
 
+Color coin_colors[] = {
+    { 255, 238, 131, 255 },
+    { 255, 174, 112, 255 },
+    WHITE
+};
+
+Color plum_colors[] = {
+    { 146, 82,  204, 255 },
+    { 255, 82,  119, 255 },
+    { 190, 140, 255, 255 }
+};
+
+Color dust_colors[] = {
+    WHITE,
+    LIGHTGRAY,
+    GRAY
+};
+
 void
-update_and_render_gravity_particle_system(Game_State* game, Particle_System* ps, bool slowdown=true, bool change_gravity=false, bool inverted=false) {
-    for_particle(ps, pa, ci) {
-        Color c = colors[ci % fixed_array_count(colors)];
-        c.a = (u8) (quad_fade_in_out(pa->t) * 255);
-        
+update_gravity_particles(Game_State* game, bool slowdown=true, bool change_gravity=false, bool inverted=false) {
+    Particle_Pool* pool = game->particles;
+    for_emitter_particle(pool, game->emitter_gravity, ci) {
         if (change_gravity) {
-            if (inverted && pa->v.y > 0.0f) pa->v.y = -pa->v.y;
-            if (!inverted && pa->v.y < 0.0f) pa->v.y = -pa->v.y;
+            if (inverted && pool->vy[ci] > 0.0f) pool->vy[ci] = -pool->vy[ci];
+            if (!inverted && pool->vy[ci] < 0.0f) pool->vy[ci] = -pool->vy[ci];
         }
         
-        v2s p = to_pixel(game, pa->p);
-        v2s p0 = to_pixel(game, pa->p - pa->v);
-        if (slowdown) pa->v *= 0.96f;
-        DrawLine(p0.x, p0.y, p.x, p.y, c);
-        DrawPixel(p.x - 1, p.y, c);
+        if (slowdown) {
+            pool->vx[ci] *= 0.96f;
+            pool->vy[ci] *= 0.96f;
+        }
         
         // Kill particles outside view vertically
-        if (pa->p.y < -2.0f || pa->p.y > game->game_height + 2.0f) {
-            pa->t = 0.0f;
+        if (pool->py[ci] < -2.0f || pool->py[ci] > game->game_height + 2.0f) {
+            pool->t[ci] = 0.0f;
         }
     }
 }
 
 void
-update_and_render_level(Game_State* game) {
-    Game_Controller controller = get_controller(game);
+draw_particles(Game_State* game, Particle_Pool* pool) {
+    // NOTE(Alexander): the whole pool is submitted as one batch of lines, the trail of each
+    // particle and its head, which is a one pixel long line to the left of the particle.
+    // Vertices are placed on pixel centers so the lines rasterize like DrawLine/ DrawPixel.
+    
+    // NOTE(Alexander): colors cycle per emitter so each effect looks the same no matter
+    // how its particles are interleaved with other emitters in the pool.
+    int emitter_particle_index[MAX_PARTICLE_EMITTERS] = {};
+    
+    rlBegin(RL_LINES);
+    for_particle(pool, ci) {
+        Particle_Emitter* emitter = &pool->emitters[pool->emitter[ci]];
+        int color_index = emitter_particle_index[emitter->index]++;
+        Color c = emitter->colors[color_index % emitter->color_count];
+        c.a = (u8) (quad_fade_in_out(pool->t[ci]) * 255);
+        
+        v2 particle_p = vec2(pool->px[ci], pool->py[ci]);
+        v2s p = to_pixel(game, particle_p);
+        v2s p0 = to_pixel(game, particle_p - vec2(pool->vx[ci], pool->vy[ci]));
+        f32 x = (f32) p.x + 0.5f;
+        f32 y = (f32) p.y + 0.5f;
+        
+        rlCheckRenderBatchLimit(4);
+        rlColor4ub(c.r, c.g, c.b, c.a);
+        rlVertex2f((f32) p0.x + 0.5f, (f32) p0.y + 0.5f);
+        rlVertex2f(x, y);
+        rlVertex2f(x - 1.0f, y);
+        rlVertex2f(x, y);
+    }
+    rlEnd();
+}
+
+void
+update_vine(Game_State* game, Entity* entity) {
+    Box* collider = get_entity_collider(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
+    Entity_Flags* player_flags = get_entity_flags(game, game->player);
+    bool expand = entity->direction.y < 0 ? 
+        player_flags->invert_gravity : !player_flags->invert_gravity;
+    
+    if (expand) {
+        if (entity->direction.y < 0) {
+            collider->size = vec2(6.0f, 1.0f);
+            //collider->size = vec2(0.2f, 6.0f);
+        } else {
+            collider->size = vec2(6.0f, 1.0f);
+            if (entity->direction.x < 0) {
+                entity->offset.x = -5.0f;
+            }
+        }
+        flags->is_solid = true;
+    } else {
+        collider->size = vec2(1.0f, 1.0f);
+        entity->offset.x = 0;
+        flags->is_solid = false;
+    }
+}
+
+// NOTE(Alexander): runs after every entity update regardless of type
+void
+update_entity_common(Game_State* game, int entity_index) {
+    Entity* entity = &game->entities[entity_index];
+    
+    // Update animations
+    Entity_Render* render = &game->entity_renders[entity_index];
+    if (render->frames > 1) {
+        render->frame_advance += game->sim_dt * (1.0f / render->frame_duration);
+        if (render->frame_advance >= render->frames) {
+            render->frame_advance -= render->frames;
+        }
+    }
     
+    // Kill areas
+    Box* collider = &game->entity_colliders[entity_index];
+    bool invert_gravity = game->entity_flags[entity_index].invert_gravity;
+    if ((invert_gravity  && collider->p.y < -collider->size.y - 0.5f) ||
+        (!invert_gravity && collider->p.y > game->game_height + 0.5f)) {
+        
+        kill_entity(game, entity);
+        if (entity->type != Player) {
+            entity->type = None;
+        }
+    }
+}
+
+void
+update_level(Game_State* game, Game_Controller* controller) {
     Box sim_window;
     sim_window.p = game->camera_p - vec2(2.0f, 2.0f);
     sim_window.size = vec2(game->game_width + 4.0f, game->game_height + 4.0f);
     
+    Box* player_collider = get_entity_collider(game, game->player);
+    Entity_Flags* player_flags = get_entity_flags(game, game->player);
     v2 game_box = vec2((f32) game->game_width, (f32) game->game_height);
-    game->ps_gravity->min_angle = game->player->invert_gravity ? -PI_F32/2.0f : PI_F32/2.0f;
-    game->ps_gravity->max_angle = game->player->invert_gravity ? -PI_F32/2.0f : PI_F32/2.0f;
-    game->ps_gravity->start_min_p = vec2(game->player->p.x - game_box.x, -game_box.y);
-    game->ps_gravity->start_max_p = vec2(game->player->p.x + game_box.x, game_box.y);
-    game->ps_gravity->min_speed = 0.01f;
-    game->ps_gravity->max_speed = 0.03f;
-    game->ps_gravity->spawn_rate = 0.05f;
-    game->ps_gravity->delta_t = 0.001f;
-    update_particle_system(game->ps_gravity, true);
+    game->emitter_gravity->min_angle = player_flags->invert_gravity ? -PI_F32/2.0f : PI_F32/2.0f;
+    game->emitter_gravity->max_angle = player_flags->invert_gravity ? -PI_F32/2.0f : PI_F32/2.0f;
+    game->emitter_gravity->start_min_p = vec2(player_collider->p.x - game_box.x, -game_box.y);
+    game->emitter_gravity->start_max_p = vec2(player_collider->p.x + game_box.x, game_box.y);
+    game->emitter_gravity->min_speed = 0.01f;
+    game->emitter_gravity->max_speed = 0.03f;
+    game->emitter_gravity->spawn_rate = 0.6f;
+    game->emitter_gravity->delta_t = 0.001f;
+    update_particle_emitter(game->particles, game->emitter_gravity, true);
     
     
     // Update game
-    for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
+    // NOTE(Alexander): entities are stored grouped by type but updated in the order they were
+    // spawned, collisions between them depend on the update order and recorded runs have to
+    // replay the same way.
+    for (int spawn_id = 0; spawn_id < game->spawned_entity_count; spawn_id++) {
+        int entity_index = game->entity_spawn_order[spawn_id];
         Entity* entity = &game->entities[entity_index];
         
         switch (entity->type) {
             case Player: {
-                update_player(game, entity, &controller);
+                update_player(game, entity, controller);
             } break;
             
             case Enemy_Plum: {
-                if (box_check(sim_window, entity->collider)) {
+                if (box_check(sim_window, *get_entity_collider(game, entity))) {
                     update_enemy_plum(game, entity);
                 }
             } break;
             
             case Enemy_Sharpie: {
-                if (box_check(sim_window, entity->collider)) {
+                if (box_check(sim_window, *get_entity_collider(game, entity))) {
                     update_enemy_sharpie(game, entity);
                 }
             } break;
             
             case Vine: {
-                bool expand = entity->direction.y < 0 ? 
-                    game->player->invert_gravity : !game->player->invert_gravity;
-                
-                if (expand) {
-                    if (entity->direction.y < 0) {
-                        entity->size = vec2(6.0f, 1.0f);
-                        //entity->size = vec2(0.2f, 6.0f);
-                    } else {
-                        entity->size = vec2(6.0f, 1.0f);
-                        if (entity->direction.x < 0) {
-                            entity->offset.x = -5.0f;
-                        }
-                    }
-                    entity->is_solid = true;
-                } else {
-                    entity->size = vec2(1.0f, 1.0f);
-                    entity->offset.x = 0;
-                    entity->is_solid = false;
-                }
-                
+                update_vine(game, entity);
             } break;
             
             default: {
@@ -784,26 +1005,10 @@ update_and_render_level(Game_State* game) {
             } break;
         }
         
-        // Update animations
-        if (entity->frames > 1) {
-            entity->frame_advance += GetFrameTime() * (1.0f / entity->frame_duration);
-            if (entity->frame_advance >= entity->frames) {
-                entity->frame_advance -= entity->frames;
-            }
-        }
-        
-        // Kill areas
-        if ((entity->invert_gravity  && entity->p.y < -entity->size.y - 0.5f) ||
-            (!entity->invert_gravity && entity->p.y > game->game_height + 0.5f)) {
-            
-            entity->health = 0;
-            if (entity->type != Player) {
-                entity->type = None;
-            }
-        }
+        update_entity_common(game, entity_index);
     }
     
-    if (game->player->health <= 0) {
+    if (get_entity_cold(game, game->player)->health <= 0) {
         set_game_mode(game, GameMode_Death_Screen);
         PlaySound(game->snd_death);
     }
@@ -811,38 +1016,41 @@ update_and_render_level(Game_State* game) {
     camera_follow_entity_x(game, game->player);
     camera_lock_y_to_zero(game);
     
-    update_and_render_gravity_particle_system(game, game->ps_gravity, false, true, game->player->invert_gravity);
-    
-    render_level(game);
+    update_gravity_particles(game, false, true, player_flags->invert_gravity);
 }
 
 void
-update_and_render_death_screen(Game_State* game) {
+update_death_screen(Game_State* game) {
     // Play death animation and restore gameplay
     restore_game_state(game);
-    render_level(game);
     
     set_game_mode(game, GameMode_Level);
 }
 
+const v2 cutscene_ability_target = { 235, 14 };
+
 void
-update_and_render_cutscene_ability(Game_State* game) {
+update_cutscene_ability(Game_State* game, Game_Controller* controller) {
     Entity* player = game->player;
-    const v2 target = vec2(235, 14);
-    game->ps_gravity->start_min_p = target;
-    game->ps_gravity->start_max_p = target + vec2(1, 1);
-    game->ps_gravity->min_angle = -PI_F32 + 0.05f;
-    game->ps_gravity->max_angle = 0.05f;
-    game->ps_gravity->min_speed = 0.05f; game->ps_gravity->max_speed = 0.6f;
-    game->ps_gravity->spawn_rate = 0.001f;
-    game->ps_gravity->delta_t = 0.01f;
+    Box* collider = get_entity_collider(game, player);
+    v2* velocity = get_entity_velocity(game, player);
+    v2* acceleration = get_entity_acceleration(game, player);
+    Entity_Flags* flags = get_entity_flags(game, player);
+    const v2 target = cutscene_ability_target;
+    game->emitter_gravity->start_min_p = target;
+    game->emitter_gravity->start_max_p = target + vec2(1, 1);
+    game->emitter_gravity->min_angle = -PI_F32 + 0.05f;
+    game->emitter_gravity->max_angle = 0.05f;
+    game->emitter_gravity->min_speed = 0.05f; game->emitter_gravity->max_speed = 0.6f;
+    game->emitter_gravity->spawn_rate = 0.001f;
+    game->emitter_gravity->delta_t = 0.01f;
     
     if (game->mode_timer < 1.5f) {
         game->ability_block = 0;
         
         // Setup
-        player->acceleration.x = 0.0f;
-        player->acceleration.y = 0.0f;
+        acceleration->x = 0.0f;
+        acceleration->y = 0.0f;
         player->direction.x = 1.0f;
         game->start_p = get_camera_to_target_p(game);
         
@@ -852,11 +1060,11 @@ update_and_render_cutscene_ability(Game_State* game) {
         center_camera_on_v2(game, game->start_p, target + vec2(0.5f, 0.5f), 1.5f, 3.0f, cubic_ease_in_out);
         
         f32 player_target = target.x - 3.0f;
-        player->acceleration.y = 9.0f;
-        if (player->p.x < player_target) {
-            player->acceleration.x = 10.0f;
+        acceleration->y = 9.0f;
+        if (collider->p.x < player_target) {
+            acceleration->x = 10.0f;
         } else {
-            player->acceleration.x = 0.0f;
+            acceleration->x = 0.0f;
         }
         
     } else if (game->mode_timer < 4.5f) {
@@ -864,116 +1072,123 @@ update_and_render_cutscene_ability(Game_State* game) {
         center_camera_zoom(game, 1.0f, 2.0f, 3.0f, 4.5f, cubic_ease_in_out);
         
     } else if (game->mode_timer < 6.0f) {
-        v2s bottom = to_pixel(game, target);
-        
         static bool played_explosion = false;
         if (!played_explosion && game->mode_timer >= 5.4f) {
             PlaySound(game->snd_explosion);
             played_explosion = true;
         }
-        
-        int height = (int) ((game->mode_timer - 5.5f)*6.0f*bottom.y);
-        height = clamp(height, 0, bottom.y);
-        int expand = (int) ((game->mode_timer - 5.7f)*64.0f);
-        expand = clamp(expand, 1, 8);
-        DrawRectangle(bottom.x + 8 - expand, 0, expand*2, height, WHITE);
     } else if (game->mode_timer < 8.0f) {
         if (game->mode_timer > 7.0f) {
             start_music_crossfade(game, game->music_gravity_unlock, 3.0f);
         }
         if (!game->ability_block) {
             // TODO(Alexander): this is really ugly hack to find the target entity, tagging didn't work
-            for_array(game->entities, it, _) {
-                if (it->p.x == target.x && it->p.y == target.y) {
+            Entity_Range range = game->entity_ranges[Gravity_Inverted];
+            for (int entity_index = range.first; entity_index < range.first + range.count; entity_index++) {
+                Entity* it = &game->entities[entity_index];
+                v2 it_p = game->entity_colliders[entity_index].p;
+                if (it_p.x == target.x && it_p.y == target.y) {
                     if (it->type == Gravity_Inverted) {
-                        *it = {};
-                        game->tile_map[(int) target.y*game->tile_map_width + (int) target.x] = 0;
+                        clear_entity(game, entity_index);
+                        set_tile(game, (int) target.x, (int) target.y, 0);
                         game->ability_block = it;
-                        particle_burst(game->ps_gravity, 200, 1.0f);
+                        particle_burst(game->particles, game->emitter_gravity, 2000, 1.0f);
                         
-                        for_particle(game->ps_gravity, pa, ci) {
-                            pa->v.y += -0.05f;
-                        }
+                        add_particle_velocity(game->particles, game->emitter_gravity, vec2(0.0f, -0.05f));
                     }
                 }
             }
         }
         
-        update_particle_system(game->ps_gravity, false);
+        update_particle_emitter(game->particles, game->emitter_gravity, false);
         
         if (game->mode_timer < 7.8f) {
-            for_particle(game->ps_gravity, pa, ci) {
-                pa->v.y += 0.005f;
-            }
+            add_particle_velocity(game->particles, game->emitter_gravity, vec2(0.0f, 0.005f));
         }
     } else {
         
         v2 game_box = vec2(game->game_width/2.0f, (f32) game->game_height); 
-        game->ps_gravity->min_angle = -PI_F32/2.0f;
-        game->ps_gravity->max_angle = -PI_F32/2.0f;
-        game->ps_gravity->start_min_p = target - vec2(game_box.x, 0.0f);
-        game->ps_gravity->start_max_p = target + game_box;
-        game->ps_gravity->spawn_rate = 0.1f;
-        game->ps_gravity->min_speed = 0.05f;
-        game->ps_gravity->max_speed = 0.7f;
-        game->ps_gravity->delta_t = 0.01f;
-        update_particle_system(game->ps_gravity, true);
+        game->emitter_gravity->min_angle = -PI_F32/2.0f;
+        game->emitter_gravity->max_angle = -PI_F32/2.0f;
+        game->emitter_gravity->start_min_p = target - vec2(game_box.x, 0.0f);
+        game->emitter_gravity->start_max_p = target + game_box;
+        game->emitter_gravity->spawn_rate = 0.1f;
+        game->emitter_gravity->min_speed = 0.05f;
+        game->emitter_gravity->max_speed = 0.7f;
+        game->emitter_gravity->delta_t = 0.01f;
+        update_particle_emitter(game->particles, game->emitter_gravity, true);
         
         if (game->mode_timer < 11.0f) {
             center_camera_zoom(game, 2.0f, 1.0f, 8.0f, 11.0f, cubic_ease_in_out);
             
             //} else if (game->mode_timer < 11.0f) {
-            center_camera_on_v2(game, target + vec2(0.5f, 0.5f), player->p, 8.0f, 11.0f, cubic_ease_in_out);
+            center_camera_on_v2(game, target + vec2(0.5f, 0.5f), collider->p, 8.0f, 11.0f, cubic_ease_in_out);
         }
         
         if (game->mode_timer > 11.0f) {
-            Game_Controller controller = get_controller(game);
             game->ability_unlock_gravity = true;
             update_tutorial(game, true, Tutorial_Switch_Gravity);
             
-            if (controller.action_pressed) {
+            if (controller->action_pressed) {
                 PlaySound(game->snd_gravity_switch);
                 player->prev_invert_gravity = true;
                 start_music_crossfade(game, game->music_level1_3, 3.0f);
                 set_game_mode(game, GameMode_Level);
-                player->invert_gravity = false;
-                player->velocity.y = 6.0f;
+                flags->invert_gravity = false;
+                velocity->y = 6.0f;
                 return;
             }
         }
         
-        player->invert_gravity = true;
-        if (player->p.y > 7) {
-            player->acceleration.y = -2;
+        flags->invert_gravity = true;
+        if (collider->p.y > 7) {
+            acceleration->y = -2;
         } else {
-            player->acceleration.y = 2;
+            acceleration->y = 2;
         }
         
         
-        if (fabsf(player->velocity.y) > 4.0f) {
-            player->velocity.y = sign(player->velocity.y)*4.0f;
+        if (fabsf(velocity->y) > 4.0f) {
+            velocity->y = sign(velocity->y)*4.0f;
         }
     }
     
     update_rigidbody(game, player);
     
+    update_gravity_particles(game);
+}
+
+void
+render_cutscene_ability(Game_State* game) {
+    if (game->mode_timer >= 4.5f && game->mode_timer < 6.0f) {
+        v2s bottom = to_pixel(game, cutscene_ability_target);
+        int height = (int) ((game->mode_timer - 5.5f)*6.0f*bottom.y);
+        height = clamp(height, 0, bottom.y);
+        int expand = (int) ((game->mode_timer - 5.7f)*64.0f);
+        expand = clamp(expand, 1, 8);
+        DrawRectangle(bottom.x + 8 - expand, 0, expand*2, height, WHITE);
+    }
+    
     render_level(game, game->mode_timer >= 8.0f, game->mode_timer >= 8.0f);
     
-    update_and_render_gravity_particle_system(game, game->ps_gravity);
+    draw_particles(game, game->particles);
 }
 
 void
-update_and_render_cutscene_endgame(Game_State* game) {
+update_cutscene_endgame(Game_State* game) {
     Entity* player = game->player;
+    Box* collider = get_entity_collider(game, player);
+    v2* acceleration = get_entity_acceleration(game, player);
+    Entity_Flags* flags = get_entity_flags(game, player);
     
     v2 game_box = vec2((f32) game->game_width, (f32) game->game_height);
-    game->ps_gravity->start_min_p = vec2(game->player->p.x - 2.0f, game_box.y + 1.0f);
-    game->ps_gravity->start_max_p = vec2(game->player->p.x - 4.0f, game_box.y + 2.0f);
-    game->ps_gravity->min_angle = -PI_F32 + 0.05f;
-    game->ps_gravity->max_angle = 0.05f;
-    game->ps_gravity->min_speed = 0.05f; game->ps_gravity->max_speed = 0.6f;
-    game->ps_gravity->spawn_rate = 0.001f;
-    game->ps_gravity->delta_t = 0.01f;
+    game->emitter_gravity->start_min_p = vec2(collider->p.x - 2.0f, game_box.y + 1.0f);
+    game->emitter_gravity->start_max_p = vec2(collider->p.x - 4.0f, game_box.y + 2.0f);
+    game->emitter_gravity->min_angle = -PI_F32 + 0.05f;
+    game->emitter_gravity->max_angle = 0.05f;
+    game->emitter_gravity->min_speed = 0.05f; game->emitter_gravity->max_speed = 0.6f;
+    game->emitter_gravity->spawn_rate = 0.001f;
+    game->emitter_gravity->delta_t = 0.01f;
     
     player->direction.x = 1.0f;
     
@@ -981,22 +1196,20 @@ update_and_render_cutscene_endgame(Game_State* game) {
     if (game->mode_timer > 1.0f) {
         if (!burst) {
             burst = true;
-            particle_burst(game->ps_gravity, 200, 1.0f);
-            for_particle(game->ps_gravity, pa, ci) {
-                pa->v.y += -0.5f;
-            }
+            particle_burst(game->particles, game->emitter_gravity, 2000, 1.0f);
+            add_particle_velocity(game->particles, game->emitter_gravity, vec2(0.0f, -0.5f));
         }
         
         if (game->mode_timer > 3.0f) {
-            game->ps_gravity->min_angle = -PI_F32/2.0f;
-            game->ps_gravity->max_angle = -PI_F32/2.0f;
-            game->ps_gravity->start_min_p = vec2(game->player->p.x - game_box.x, game_box.y);
-            game->ps_gravity->start_max_p = vec2(game->player->p.x + game_box.x, game_box.y);
-            game->ps_gravity->spawn_rate = 0.1f;
-            game->ps_gravity->min_speed = 0.05f;
-            game->ps_gravity->max_speed = 0.7f;
-            game->ps_gravity->delta_t = 0.01f;
-            update_particle_system(game->ps_gravity, true);
+            game->emitter_gravity->min_angle = -PI_F32/2.0f;
+            game->emitter_gravity->max_angle = -PI_F32/2.0f;
+            game->emitter_gravity->start_min_p = vec2(collider->p.x - game_box.x, game_box.y);
+            game->emitter_gravity->start_max_p = vec2(collider->p.x + game_box.x, game_box.y);
+            game->emitter_gravity->spawn_rate = 0.1f;
+            game->emitter_gravity->min_speed = 0.05f;
+            game->emitter_gravity->max_speed = 0.7f;
+            game->emitter_gravity->delta_t = 0.01f;
+            update_particle_emitter(game->particles, game->emitter_gravity, true);
         }
         
     }
@@ -1008,47 +1221,111 @@ update_and_render_cutscene_endgame(Game_State* game) {
     start_music_crossfade(game, game->music_gravity_unlock, 2.0f);
     
     player->max_speed.x = 2.0f;
-    player->acceleration.x = 2.0f;
-    player->acceleration.y = player->invert_gravity ? -9.0f : 9.0f;
+    acceleration->x = 2.0f;
+    acceleration->y = flags->invert_gravity ? -9.0f : 9.0f;
     
-    update_particle_system(game->ps_gravity, game->mode_timer > 3.0f);
+    update_particle_emitter(game->particles, game->emitter_gravity, game->mode_timer > 3.0f);
     
     update_rigidbody(game, player);
     
-    render_level(game);
-    
-    update_and_render_gravity_particle_system(game, game->ps_gravity);
+    update_gravity_particles(game);
 }
 
 
 void
-game_update_and_render(Game_State* game, RenderTexture2D render_target) {
+simulate(Game_State* game, Game_Controller* controller) {
+    for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
+        game->entity_renders[entity_index].prev_p = game->entity_colliders[entity_index].p;
+    }
+    game->prev_camera_p = game->camera_p;
     
-    // Render game
-    BeginTextureMode(render_target);
-    ClearBackground(BACKGROUND_COLOR);
+    // NOTE(Alexander): the first step of a new mode or level (respawning goes through the
+    // death screen) places the camera directly, it would sweep across the level if interpolated.
+    bool snap_camera = game->snap_camera;
+    game->snap_camera = false;
     
     switch (game->mode) {
         case GameMode_Level: {
-            update_and_render_level(game);
+            update_level(game, controller);
         } break;
         
         case GameMode_Death_Screen: {
-            update_and_render_death_screen(game);
+            update_death_screen(game);
         } break;
         
         case GameMode_Cutscene_Ability: {
-            update_and_render_cutscene_ability(game);
+            update_cutscene_ability(game, controller);
         } break;
         
         case GameMode_Cutscene_Endgame: {
-            update_and_render_cutscene_endgame(game);
+            update_cutscene_endgame(game);
         } break;
     }
     
-    game->mode_timer += GetFrameTime();
+    if (snap_camera) {
+        game->prev_camera_p = game->camera_p;
+    }
+    
+    game->mode_timer += game->sim_dt;
+    
+    // NOTE(Alexander): the gravity emitter is stepped by each game mode, all the effect
+    // emitters are updated together here.
+    update_particles(game->particles, ALL_PARTICLE_EMITTERS & ~emitter_bit(game->emitter_gravity));
+    
+    // NOTE(Alexander): re-bucket after the step so the renderer also sees where entities are
+    update_spatial_grid(game);
+}
+
+void
+render(Game_State* game) {
+    switch (game->mode) {
+        case GameMode_Cutscene_Ability: {
+            render_cutscene_ability(game);
+        } break;
+        
+        default: {
+            render_level(game);
+            draw_particles(game, game->particles);
+        } break;
+    }
+}
+
+void
+game_update_and_render(Game_State* game, RenderTexture2D render_target) {
+    clear(&game->frame_arena);
+    
+    // NOTE(Alexander): button presses are kept until a simulation step has consumed them
+    Game_Controller controller = get_controller(game);
+    controller.jump_pressed = controller.jump_pressed || game->controller.jump_pressed;
+    controller.action_pressed = controller.action_pressed || game->controller.action_pressed;
+    game->controller = controller;
+    
+    // Run the simulation at a fixed rate, clamp the frame time so a hitch
+    // can't make us spend the next frame catching up forever.
+    game->sim_accumulator += min(GetFrameTime(), MAX_FRAME_TIME);
+    while (game->sim_accumulator >= game->sim_dt) {
+        simulate(game, &game->controller);
+        game->sim_accumulator -= game->sim_dt;
+        
+        game->controller.jump_pressed = false;
+        game->controller.action_pressed = false;
+    }
+    game->render_alpha = game->sim_accumulator / game->sim_dt;
     
+    // NOTE(Alexander): draw with the camera interpolated between the last two simulation steps
+    v2 sim_camera_p = game->camera_p;
+    game->camera_p = lerp(game->prev_camera_p, game->camera_p, game->render_alpha);
+    
+    // Render game
+#if CACHE_TILE_CHUNKS
+    update_tile_chunks(game);
+#endif
+    BeginTextureMode(render_target);
+    ClearBackground(BACKGROUND_COLOR);
+    render(game);
     EndTextureMode();
+    
+    game->camera_p = sim_camera_p;
 }
 
 #define DEF_LEVEL1 \
@@ -1059,27 +1336,66 @@ LVL("level1_4") \
 LVL("level1_5")
 
 cstring level_assets[] = {
-#define LVL(filename) "assets/" filename ".tmx", 
+#define LVL(filename) "assets/" filename ".lvl", 
     DEF_LEVEL1
 #undef LVL
 };
 
+void
+init_game_state(Game_State* game) {
+    game->game_width = 40;
+    game->game_height = 22;
+    game->game_scale = 2;
+    game->render_width = game->game_width * TILE_SIZE;
+    game->render_height = game->game_height * TILE_SIZE;
+    game->screen_width = game->render_width * game->game_scale;
+    game->screen_height = game->render_height * game->game_scale;
+    game->particles = init_particle_pool(PARTICLE_POOL_SIZE, PARTICLE_SEED);
+    // NOTE(Alexander): the gravity field gets what is left of the pool after the effects
+    game->emitter_gravity = add_particle_emitter(game->particles, PARTICLE_POOL_SIZE - 4*256, colors, fixed_array_count(colors));
+    game->emitter_coin = add_particle_emitter(game->particles, 256, coin_colors, fixed_array_count(coin_colors));
+    game->emitter_plum_death = add_particle_emitter(game->particles, 256, plum_colors, fixed_array_count(plum_colors));
+    game->emitter_landing = add_particle_emitter(game->particles, 256, dust_colors, fixed_array_count(dust_colors));
+    game->emitter_gravity_switch = add_particle_emitter(game->particles, 256, colors, fixed_array_count(colors));
+    
+    game->emitter_coin->min_angle = -PI_F32;
+    game->emitter_coin->max_angle = PI_F32;
+    game->emitter_coin->min_speed = 0.02f;
+    game->emitter_coin->max_speed = 0.06f;
+    game->emitter_coin->delta_t = 0.04f;
+    
+    game->emitter_plum_death->min_angle = -PI_F32;
+    game->emitter_plum_death->max_angle = PI_F32;
+    game->emitter_plum_death->min_speed = 0.03f;
+    game->emitter_plum_death->max_speed = 0.08f;
+    game->emitter_plum_death->delta_t = 0.03f;
+    
+    game->emitter_landing->min_speed = 0.02f;
+    game->emitter_landing->max_speed = 0.05f;
+    game->emitter_landing->delta_t = 0.05f;
+    
+    game->emitter_gravity_switch->min_angle = -PI_F32;
+    game->emitter_gravity_switch->max_angle = PI_F32;
+    game->emitter_gravity_switch->min_speed = 0.05f;
+    game->emitter_gravity_switch->max_speed = 0.1f;
+    game->emitter_gravity_switch->delta_t = 0.05f;
+    game->sim_dt = 1.0f / SIM_HZ;
+    set_minimum_arena_block_size(&game->frame_arena, kilobytes(64));
+    
+    game->normal_gravity = 20;
+    game->fall_gravity = 50;
+    
+    game->meters_to_pixels = TILE_SIZE;
+    game->pixels_to_meters = 1.0f/game->meters_to_pixels;
+    
+    set_game_mode(game, GameMode_Level);
+}
+
+#if !HEADLESS
 int
 main() {
     Game_State game = {};
-    game.game_width = 40;
-    game.game_height = 22;
-    game.game_scale = 2;
-    game.render_width = game.game_width * TILE_SIZE;
-    game.render_height = game.game_height * TILE_SIZE;
-    game.screen_width = game.render_width * game.game_scale;
-    game.screen_height = game.render_height * game.game_scale;
-    game.ps_gravity = init_particle_system(200);
-    
-    game.normal_gravity = 20;
-    game.fall_gravity = 50;
-    
-    set_game_mode(&game, GameMode_Level);
+    init_game_state(&game);
     
     SetConfigFlags(FLAG_VSYNC_HINT);
     InitWindow(game.screen_width, game.screen_height, "Bigmode Game Jam 2023");
@@ -1096,11 +1412,11 @@ main() {
     SetExitKey(0);
     
     Memory_Arena level_arena = {};
-    game.meters_to_pixels = TILE_SIZE;
-    game.pixels_to_meters = 1.0f/game.meters_to_pixels;
+    set_minimum_arena_block_size(&level_arena, kilobytes(256));
 #define TEX2D(name, filename) game.texture_##name = LoadTexture("assets/" filename);
     DEF_TEXUTRE2D
 #undef TEX2D
+    load_sprites(&game);
     
 #define SND(name, filename) game.snd_##name = LoadSound("assets/" filename);
     DEF_SOUND
@@ -1169,4 +1485,5 @@ main() {
     
     CloseWindow();
     return 0;
-}
\ No newline at end of file
+}
+#endif
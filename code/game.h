@@ -17,6 +17,8 @@ enum Entity_Type {
     Vine,
     Gravity_Normal,
     Gravity_Inverted,
+    
+    Entity_Type_Count,
 };
 
 enum Entity_Layer {
@@ -62,49 +64,141 @@ struct Trigger {
     string tag;
 };
 
+// NOTE(Alexander): uniform grid broadphase, static colliders are inserted once
+// at level setup and dynamic entities are re-bucketed every frame.
+#define GRID_CELL_SIZE 8
+#define GRID_MARGIN 1.0f
+
+struct Spatial_Grid_Entry {
+    s32 index; // collider index for static entries, spawn id for dynamic ones
+    s32 next;
+};
+
+struct Spatial_Grid {
+    s32* static_cells; // first entry in each cell, -1 if empty
+    s32* dynamic_cells;
+    s32 width;
+    s32 height;
+    
+    Spatial_Grid_Entry* static_entries;
+    s32 static_entry_count;
+    s32 max_static_entry_count;
+    
+    Spatial_Grid_Entry* dynamic_entries;
+    s32 dynamic_entry_count;
+    s32 max_dynamic_entry_count;
+};
+
+// NOTE(Alexander): a tile is the tileset gid in the low bits and the Tiled flip flags in
+// the top three bits, zero is an empty tile. 16 bits allows tilesets of up to 8191 tiles,
+// build with TILE_BITS=32 for larger ones.
+#ifndef TILE_BITS
+#define TILE_BITS 16
+#endif
+
+#if TILE_BITS == 16
+typedef u16 Tile;
+#elif TILE_BITS == 32
+typedef u32 Tile;
+#else
+#error "TILE_BITS has to be 16 or 32"
+#endif
+
+#define TILE_FLIP_HORIZONTAL ((Tile) (1u << (TILE_BITS - 1)))
+#define TILE_FLIP_VERTICAL ((Tile) (1u << (TILE_BITS - 2)))
+#define TILE_FLIP_DIAGONAL ((Tile) (1u << (TILE_BITS - 3)))
+#define TILE_GID_MASK ((Tile) (TILE_FLIP_DIAGONAL - 1))
+#define get_tile_gid(tile) ((tile) & TILE_GID_MASK)
+
+// NOTE(Alexander): the tile map is pre-rendered in chunks, a small cache of render
+// textures is assigned to the chunks on screen and only redrawn when a tile changes.
+#define TILE_CHUNK_WIDTH 32
+#define TILE_CHUNK_HEIGHT 22
+#define TILE_CHUNK_CACHE_COUNT 8
+
+// NOTE(Alexander): sprites are collected per layer and drawn sorted by texture,
+// each run of quads with the same texture is submitted to rlgl as one batch.
+struct Sprite_Quad {
+    Texture2D texture;
+    Rectangle src;
+    Rectangle dest;
+};
+
+struct Sprite_Batch {
+    Sprite_Quad* quads; // allocated in the frame arena, null when not batching
+    int count;
+    int max_count;
+};
+
+struct Tile_Chunk {
+    RenderTexture2D target;
+    s32 chunk_x;
+    s32 chunk_y;
+    u32 last_used_frame;
+    bool is_used;
+    bool is_dirty;
+};
+
+// NOTE(Alexander): the position/size, velocity, acceleration and flags are the fields the
+// collision checks and the broadphase go through every step, they live in their own arrays
+// (same index as the entity), the Entity pointer is just a handle into those arrays.
+struct Entity_Flags {
+    bool is_solid;
+    bool is_trigger;
+    bool is_rigidbody;
+    bool is_grounded;
+    bool is_jumping;
+    bool invert_gravity;
+};
+
 struct Entity {
-    string* tag;
-    
     // Physics/ collider (and render shape)
-    Entity* collided_with;
     Collision collision;
     int map_collision;
     
-    union {
-        struct {
-            v2 p;
-            v2 size;
-        };
-        Box collider;
-    };
     v2 offset;
-    v2 velocity;
-    v2 acceleration;
     v2 max_speed;
     v2 direction;
     
-    bool invert_gravity;
     bool prev_invert_gravity;
     f32 gravity;
     f32 fall_gravity;
     
-    // Rendering
-    Texture2D* sprite;
+    Entity_Type type;
+};
+
+// NOTE(Alexander): a region of a texture in pixels, most sprites share the atlas texture
+struct Sprite {
+    Texture2D texture;
+    Rectangle region;
+};
+
+// NOTE(Alexander): render data is stored in a separate array (same index as the entity)
+// so the physics and broadphase loops only pull in the data they actually use.
+struct Entity_Render {
+    Sprite* sprite;
     f32 frame_advance;
     f32 frame_duration;
     int frames;
-    
-    Entity_Type type;
     Entity_Layer layer;
     
+    v2 prev_p; // position at the start of the simulation step, used for interpolation
+};
+
+// NOTE(Alexander): gameplay data that is only looked at after a collision or by the level
+// setup, kept in its own array (same index as the entity) for the same reason as Entity_Render.
+struct Entity_Cold {
+    string* tag;
+    Entity* collided_with;
     s32 health;
-    
     Collision collision_mask; // make solid on certain directions
-    bool is_solid;
-    bool is_trigger;
-    bool is_rigidbody;
-    bool is_grounded;
-    bool is_jumping;
+};
+
+// NOTE(Alexander): entities are stored sorted by their spawn type
+struct Entity_Range {
+    int first;
+    int count;
+    int max_count;
 };
 
 enum Game_Mode {
@@ -114,6 +208,16 @@ enum Game_Mode {
     GameMode_Death_Screen,
 };
 
+struct Game_Controller {
+    v2 dir;
+    
+    bool jump_pressed;
+    bool jump_down;
+    bool action_pressed;
+    
+    bool is_gamepad;
+};
+
 struct Saved_Entity {
     Entity_Type type;
     v2 p;
@@ -123,24 +227,28 @@ struct Saved_Entity {
 
 #define DEF_TEXUTRE2D \
 TEX2D(tiles, "tileset_rock.png") \
-TEX2D(character, "character.png") \
-TEX2D(character_inv, "character_inv.png") \
-TEX2D(coin, "moon_coin.png") \
-TEX2D(ui_coin, "ui_coin.png") \
-TEX2D(spikes, "spikes.png") \
-TEX2D(plum, "plum.png") \
-TEX2D(plum_dead, "plum_dead.png") \
-TEX2D(sharpie, "sharpie.png") \
-TEX2D(vine, "vine.png") \
-TEX2D(space, "space.png") \
-TEX2D(ui_walk_keyboard, "ui_walk_keyboard.png") \
-TEX2D(ui_jump_keyboard, "ui_jump_keyboard.png") \
-TEX2D(ui_long_jump_keyboard, "ui_jump_keyboard.png") \
-TEX2D(ui_gravity_keyboard, "ui_gravity_keyboard.png") \
-TEX2D(ui_walk_gamepad, "ui_walk_gamepad.png") \
-TEX2D(ui_jump_gamepad, "ui_jump_gamepad.png") \
-TEX2D(ui_long_jump_gamepad, "ui_jump_gamepad.png") \
-TEX2D(ui_gravity_gamepad, "ui_gravity_gamepad.png") \
+
+// NOTE(Alexander): packed sprites are baked into one atlas at load time, space is
+// kept as its own texture since the gravity blocks scroll it using texture wrapping.
+#define DEF_SPRITE \
+SPRITE(character, "character.png", true) \
+SPRITE(character_inv, "character_inv.png", true) \
+SPRITE(coin, "moon_coin.png", true) \
+SPRITE(ui_coin, "ui_coin.png", true) \
+SPRITE(spikes, "spikes.png", true) \
+SPRITE(plum, "plum.png", true) \
+SPRITE(plum_dead, "plum_dead.png", true) \
+SPRITE(sharpie, "sharpie.png", true) \
+SPRITE(vine, "vine.png", true) \
+SPRITE(space, "space.png", false) \
+SPRITE(ui_walk_keyboard, "ui_walk_keyboard.png", true) \
+SPRITE(ui_jump_keyboard, "ui_jump_keyboard.png", true) \
+SPRITE(ui_long_jump_keyboard, "ui_jump_keyboard.png", true) \
+SPRITE(ui_gravity_keyboard, "ui_gravity_keyboard.png", true) \
+SPRITE(ui_walk_gamepad, "ui_walk_gamepad.png", true) \
+SPRITE(ui_jump_gamepad, "ui_jump_gamepad.png", true) \
+SPRITE(ui_long_jump_gamepad, "ui_jump_gamepad.png", true) \
+SPRITE(ui_gravity_gamepad, "ui_gravity_gamepad.png", true) \
 
 #define DEF_SOUND \
 SND(pickup_moon, "pickup_moon.wav") \
@@ -159,27 +267,49 @@ MUSIC(gravity_unlock, "gravity_unlock.wav") \
 struct Game_State {
     Entity* player;
     
-    Entity entities[255];
+    // NOTE(Alexander): level pools are allocated in the level arena and sized
+    // from the number of objects in the tmx file, so indices are stable.
+    Entity* entities;
+    Box* entity_colliders;
+    v2* entity_velocities;
+    v2* entity_accelerations;
+    Entity_Flags* entity_flags;
+    Entity_Render* entity_renders;
+    Entity_Cold* entity_colds;
+    Saved_Entity* saved_entities;
+    Entity_Range entity_ranges[Entity_Type_Count];
     int entity_count;
     
-    Saved_Entity saved_entities[255];
-    //int saved_entity_count;
+    // NOTE(Alexander): entity index for each spawn id, i.e. in the order the entities appear
+    // in the level. The simulation and the broadphase go through the entities in this order.
+    s32* entity_spawn_order;
+    int spawned_entity_count;
     
     bool ability_unlock_gravity;
     
-    Box colliders[255];
+    Box* colliders; // growable, baked colliders are added after the tmx colliders
     int collider_count;
+    int max_collider_count;
     
-    Box checkpoints[20];
+    Box* checkpoints;
     int checkpoint_count;
+    int max_checkpoint_count;
     
-    Trigger triggers[10];
+    Trigger* triggers;
     int trigger_count;
+    int max_trigger_count;
+    
+    Spatial_Grid grid;
     
     Game_Mode mode;
     f32 mode_timer;
     f32 global_timer;
     
+    Game_Controller controller;
+    f32 sim_dt;
+    f32 sim_accumulator;
+    f32 render_alpha;
+    
     Tutorial curr_tutorials;
     Tutorial finished_tutorials;
     Tutorial saved_finished_tutorials;
@@ -189,6 +319,8 @@ struct Game_State {
     s32 saved_coins;
     
     v2 camera_p;
+    v2 prev_camera_p;
+    bool snap_camera; // the next step cuts the camera, don't interpolate from the old position
     
     v2 start_p; // start position of the current mode
     Entity* ability_block; // for cutsceen when you get the ability
@@ -212,6 +344,10 @@ struct Game_State {
 #define TEX2D(name, ...) Texture2D texture_##name;
     DEF_TEXUTRE2D
 #undef TEX2D
+#define SPRITE(name, ...) Sprite sprite_##name;
+    DEF_SPRITE
+#undef SPRITE
+    Texture2D texture_atlas;
 #define SND(name, ...) Sound snd_##name;
     DEF_SOUND
 #undef SND
@@ -220,11 +356,28 @@ struct Game_State {
 #undef MUSIC
     Font font_default;
     
-    Particle_System* ps_gravity;
+    Particle_Pool* particles;
+    Particle_Emitter* emitter_gravity;
+    Particle_Emitter* emitter_coin;
+    Particle_Emitter* emitter_plum_death;
+    Particle_Emitter* emitter_landing;
+    Particle_Emitter* emitter_gravity_switch;
+    
+    Memory_Arena* level_arena;
+    
+    // NOTE(Alexander): scratch memory that is cleared at the start of every frame
+    Memory_Arena frame_arena;
     
-    u8* tile_map;
+    Tile* tile_map;
     int tile_map_width;
     int tile_map_height;
+    bool* solid_tiles;
+    int solid_tile_count;
+    bool use_tile_collision;
+    
+    Sprite_Batch sprite_batch;
+    Tile_Chunk tile_chunks[TILE_CHUNK_CACHE_COUNT];
+    u32 tile_chunk_frame;
     
     int game_width;
     int game_height;
@@ -280,6 +433,26 @@ is_tutorial_active(Game_State* game, Tutorial tutorial) {
     return game->curr_tutorials & tutorial;
 }
 
+inline Box*
+get_entity_collider(Game_State* game, Entity* entity) {
+    return &game->entity_colliders[entity - game->entities];
+}
+
+inline v2*
+get_entity_velocity(Game_State* game, Entity* entity) {
+    return &game->entity_velocities[entity - game->entities];
+}
+
+inline v2*
+get_entity_acceleration(Game_State* game, Entity* entity) {
+    return &game->entity_accelerations[entity - game->entities];
+}
+
+inline Entity_Flags*
+get_entity_flags(Game_State* game, Entity* entity) {
+    return &game->entity_flags[entity - game->entities];
+}
+
 inline void
 set_game_mode(Game_State* game, Game_Mode mode) {
     game->mode = mode;
@@ -287,12 +460,13 @@ set_game_mode(Game_State* game, Game_Mode mode) {
     game->final_render_offset = {};
     game->final_render_zoom = 1.0f;
     game->final_render_rot = 0.0f;
+    game->snap_camera = true;
     
     if (game->player) {
-        game->start_p = game->player->p;
+        game->start_p = get_entity_collider(game, game->player)->p;
     }
     
-    reset_particle_system(game->ps_gravity);
+    reset_particle_pool(game->particles);
 }
 
 #define for_array(arr, it, it_index) \
@@ -301,16 +475,6 @@ for (auto it = arr; \
 it_index < fixed_array_count(arr); \
 it_index++, it++)
 
-struct Game_Controller {
-    v2 dir;
-    
-    bool jump_pressed;
-    bool jump_down;
-    bool action_pressed;
-    
-    bool is_gamepad;
-};
-
 Game_Controller
 get_controller(Game_State* game, int gamepad_index=0) {
     
@@ -360,18 +524,79 @@ get_controller(Game_State* game, int gamepad_index=0) {
     return result;
 }
 
+#define push_frame_array(game, count, type) \
+push_array_of_structs(&(game)->frame_arena, count, type, PushFlag_NoClear)
+
+#define push_frame_format(game, format, ...) \
+push_format_cstring(&(game)->frame_arena, format, ##__VA_ARGS__)
+
+inline void
+set_tile(Game_State* game, int x, int y, Tile tile) {
+    game->tile_map[y*game->tile_map_width + x] = tile;
+    
+    for_array(game->tile_chunks, chunk, _) {
+        if (chunk->is_used &&
+            chunk->chunk_x == x / TILE_CHUNK_WIDTH &&
+            chunk->chunk_y == y / TILE_CHUNK_HEIGHT) {
+            chunk->is_dirty = true;
+        }
+    }
+}
+
+inline Entity_Render*
+get_entity_render(Game_State* game, Entity* entity) {
+    return &game->entity_renders[entity - game->entities];
+}
+
+inline Entity_Cold*
+get_entity_cold(Game_State* game, Entity* entity) {
+    return &game->entity_colds[entity - game->entities];
+}
+
+inline Entity*
+get_entity_by_spawn_id(Game_State* game, s32 spawn_id) {
+    return &game->entities[game->entity_spawn_order[spawn_id]];
+}
+
+inline Entity*
+clear_entity(Game_State* game, int entity_index) {
+    game->entities[entity_index] = {};
+    game->entity_colliders[entity_index] = {};
+    game->entity_velocities[entity_index] = {};
+    game->entity_accelerations[entity_index] = {};
+    game->entity_flags[entity_index] = {};
+    game->entity_renders[entity_index] = {};
+    game->entity_colds[entity_index] = {};
+    return &game->entities[entity_index];
+}
+
+// NOTE(Alexander): the entity ranges has to be reserved up front, see reserve_entity_ranges
 inline Entity*
 add_entity(Game_State* game, Entity_Type type) {
-    assert(game->entity_count < fixed_array_count(game->entities) && "too many entities");
-    Entity* entity = &game->entities[game->entity_count++]; 
-    *entity = {};
+    Entity_Range* range = &game->entity_ranges[type];
+    assert(range->count < range->max_count && "entity range is full");
+    int entity_index = range->first + range->count++;
+    
+    game->entity_spawn_order[game->spawned_entity_count++] = entity_index;
+    
+    Entity* entity = clear_entity(game, entity_index);
     entity->type = type;
     return entity;
 }
 
 inline void
 add_collider(Game_State* game, v2 p, v2 size) {
-    assert(game->collider_count < fixed_array_count(game->colliders) && "too many colliders");
+    if (game->collider_count >= game->max_collider_count) {
+        // NOTE(Alexander): the old array is reclaimed when the level arena is cleared
+        int max_collider_count = max(game->max_collider_count*2, 64);
+        Box* colliders = push_array_of_structs(game->level_arena, max_collider_count, Box, PushFlag_NoClear);
+        if (game->collider_count > 0) {
+            memcpy(colliders, game->colliders, game->collider_count*sizeof(Box));
+        }
+        game->colliders = colliders;
+        game->max_collider_count = max_collider_count;
+    }
+    
     Box* collider = &game->colliders[game->collider_count++];
     collider->p = p;
     collider->size = size;
@@ -379,7 +604,7 @@ add_collider(Game_State* game, v2 p, v2 size) {
 
 inline void
 add_trigger(Game_State* game, v2 p, v2 size, string tag) {
-    assert(game->trigger_count < fixed_array_count(game->triggers) && "too many triggers");
+    assert(game->trigger_count < game->max_trigger_count && "too many triggers");
     Trigger* trigger = &game->triggers[game->trigger_count++];
     trigger->p = p;
     trigger->size = size;
@@ -388,7 +613,7 @@ add_trigger(Game_State* game, v2 p, v2 size, string tag) {
 
 inline void
 add_checkpoint(Game_State* game, v2 p, v2 size) {
-    assert(game->checkpoint_count < fixed_array_count(game->checkpoints) && "too many checkpoints");
+    assert(game->checkpoint_count < game->max_checkpoint_count && "too many checkpoints");
     Box* collider = &game->checkpoints[game->checkpoint_count++];
     collider->p = p;
     collider->size = size;
@@ -0,0 +1,507 @@
+// NOTE(Alexander): headless build of the game simulation, used for benchmarking
+// the physics and validating recorded runs without a window or audio device.
+// All the raylib calls made by the game compile to no-ops that only record
+// what would have been drawn.
+#define HEADLESS 1
+
+#include "game.cpp"
+
+#include <time.h>
+
+struct Headless_Draw_Stats {
+    s64 texture_draws;
+    s64 shape_draws;
+    s64 text_draws;
+    s64 sounds_played;
+};
+
+static Headless_Draw_Stats headless_stats;
+
+/***************************************************************************
+ * raylib replacement, window, audio and drawing are no-ops
+ ***************************************************************************/
+
+extern "C" {
+    
+    void InitWindow(int width, int height, const char* title) {}
+    void CloseWindow(void) {}
+    bool WindowShouldClose(void) { return true; }
+    bool IsWindowFullscreen(void) { return false; }
+    void ToggleFullscreen(void) {}
+    void MaximizeWindow(void) {}
+    void SetWindowState(unsigned int flags) {}
+    void SetConfigFlags(unsigned int flags) {}
+    void SetExitKey(int key) {}
+    int GetScreenHeight(void) { return 0; }
+    int GetCurrentMonitor(void) { return 0; }
+    int GetMonitorHeight(int monitor) { return 0; }
+    float GetFrameTime(void) { return 0.0f; }
+    
+    bool IsKeyDown(int key) { return false; }
+    bool IsKeyPressed(int key) { return false; }
+    bool IsGamepadAvailable(int gamepad) { return false; }
+    bool IsGamepadButtonDown(int gamepad, int button) { return false; }
+    bool IsGamepadButtonPressed(int gamepad, int button) { return false; }
+    float GetGamepadAxisMovement(int gamepad, int axis) { return 0.0f; }
+    
+    void BeginDrawing(void) {}
+    void EndDrawing(void) {}
+    void BeginTextureMode(RenderTexture2D target) {}
+    void EndTextureMode(void) {}
+    void ClearBackground(Color color) {}
+    void DrawFPS(int x, int y) {}
+    
+    void DrawLine(int start_x, int start_y, int end_x, int end_y, Color color) { headless_stats.shape_draws++; }
+    void DrawPixel(int x, int y, Color color) { headless_stats.shape_draws++; }
+    void DrawRectangle(int x, int y, int width, int height, Color color) { headless_stats.shape_draws++; }
+    void DrawTexturePro(Texture2D texture, Rectangle src, Rectangle dest, Vector2 origin, float rotation, Color tint) { headless_stats.texture_draws++; }
+    void DrawTextureEx(Texture2D texture, Vector2 p, float rotation, float scale, Color tint) { headless_stats.texture_draws++; }
+    void DrawTextEx(Font font, const char* text, Vector2 p, float font_size, float spacing, Color tint) { headless_stats.text_draws++; }
+    
+    void rlBegin(int mode) { if (mode == RL_QUADS) headless_stats.texture_draws++; else headless_stats.shape_draws++; }
+    void rlEnd(void) {}
+    void rlVertex2f(float x, float y) {}
+    void rlTexCoord2f(float x, float y) {}
+    void rlColor4ub(unsigned char r, unsigned char g, unsigned char b, unsigned char a) {}
+    void rlSetTexture(unsigned int id) {}
+    bool rlCheckRenderBatchLimit(int vertex_count) { return false; }
+    
+    Texture2D LoadTexture(const char* filename) { Texture2D result = {}; return result; }
+    Texture2D LoadTextureFromImage(Image image) { Texture2D result = {}; return result; }
+    Image LoadImage(const char* filename) { Image result = {}; return result; }
+    Image GenImageColor(int width, int height, Color color) { Image result = {}; return result; }
+    void ImageDraw(Image* dest, Image src, Rectangle src_rect, Rectangle dest_rect, Color tint) {}
+    void UnloadImage(Image image) {}
+    RenderTexture2D LoadRenderTexture(int width, int height) { RenderTexture2D result = {}; return result; }
+    void SetTextureFilter(Texture2D texture, int filter) {}
+    Font LoadFontEx(const char* filename, int font_size, int* codepoints, int codepoint_count) { Font result = {}; return result; }
+    
+    void InitAudioDevice(void) {}
+    Sound LoadSound(const char* filename) { Sound result = {}; return result; }
+    void PlaySound(Sound sound) { headless_stats.sounds_played++; }
+    Music LoadMusicStream(const char* filename) { Music result = {}; return result; }
+    void PlayMusicStream(Music music) {}
+    void StopMusicStream(Music music) {}
+    void UpdateMusicStream(Music music) {}
+    void SetMusicVolume(Music music, float volume) {}
+    
+    RayCollision GetRayCollisionBox(Ray ray, BoundingBox box) { RayCollision result = {}; return result; }
+    
+    unsigned char* LoadFileData(const char* filename, int* data_size) {
+        *data_size = 0;
+        FILE* file = fopen(filename, "rb");
+        if (!file) return 0;
+        
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+        
+        unsigned char* result = (unsigned char*) malloc(size > 0 ? size : 1);
+        if (result) {
+            *data_size = (int) fread(result, 1, size, file);
+        }
+        fclose(file);
+        return result;
+    }
+    
+    int GetFileLength(const char* filename) {
+        FILE* file = fopen(filename, "rb");
+        if (!file) return 0;
+        
+        fseek(file, 0, SEEK_END);
+        int result = (int) ftell(file);
+        fclose(file);
+        return result;
+    }
+    
+    void UnloadFileData(unsigned char* data) {
+        free(data);
+    }
+    
+    bool SaveFileData(const char* filename, void* data, int data_size) {
+        FILE* file = fopen(filename, "wb");
+        if (!file) return false;
+        
+        bool result = fwrite(data, 1, data_size, file) == (size_t) data_size;
+        fclose(file);
+        return result;
+    }
+}
+
+/***************************************************************************
+ * Scripted input
+ ***************************************************************************/
+
+// NOTE(Alexander): input scripts are plain text, each line holds a set of buttons
+// for a number of simulation steps, e.g. "30 right jump". Jump and action are
+// pressed on the first step of a line unless they were already held before.
+struct Input_Command {
+    s32 steps;
+    v2 dir;
+    bool jump;
+    bool action;
+};
+
+struct Input_Script {
+    Input_Command* commands;
+    s32 command_count;
+    s32 max_command_count;
+    s32 command_index;
+    s32 step_index;
+    bool repeat;
+    
+    bool prev_jump;
+    bool prev_action;
+};
+
+bool
+load_input_script(Input_Script* script, cstring filename, Memory_Arena* arena) {
+    Read_File_Result file = read_entire_file(filename);
+    if (!file.contents) return false;
+    
+    u8* scan = (u8*) file.contents;
+    u8* end = scan + file.contents_size;
+    while (scan < end) {
+        u8* line_end = scan;
+        while (line_end < end && *line_end != '\n') {
+            line_end++;
+        }
+        
+        char buffer[256];
+        int count = (int) min(line_end - scan, (smm) sizeof(buffer) - 1);
+        memcpy(buffer, scan, count);
+        buffer[count] = 0;
+        scan = line_end + 1;
+        
+        char* token = strtok(buffer, " \t\r");
+        if (!token || token[0] == '#') continue;
+        
+        if (script->command_count >= script->max_command_count) {
+            s32 max_command_count = max(script->max_command_count*2, 64);
+            Input_Command* commands = push_array_of_structs(arena, max_command_count, Input_Command);
+            if (script->command_count > 0) {
+                memcpy(commands, script->commands, script->command_count*sizeof(Input_Command));
+            }
+            script->commands = commands;
+            script->max_command_count = max_command_count;
+        }
+        
+        Input_Command* command = &script->commands[script->command_count++];
+        command->steps = atoi(token);
+        
+        while ((token = strtok(0, " \t\r")) != 0) {
+            if (strcmp(token, "left") == 0) command->dir.x -= 1.0f;
+            else if (strcmp(token, "right") == 0) command->dir.x += 1.0f;
+            else if (strcmp(token, "up") == 0) command->dir.y -= 1.0f;
+            else if (strcmp(token, "down") == 0) command->dir.y += 1.0f;
+            else if (strcmp(token, "jump") == 0) command->jump = true;
+            else if (strcmp(token, "action") == 0) command->action = true;
+            else printf("warning: unknown input `%s`\n", token);
+        }
+    }
+    
+    free_file_data(file.contents);
+    return true;
+}
+
+Game_Controller
+next_scripted_input(Input_Script* script) {
+    Game_Controller result = {};
+    
+    while (script->command_index < script->command_count &&
+           script->step_index >= script->commands[script->command_index].steps) {
+        script->command_index++;
+        script->step_index = 0;
+        if (script->repeat && script->command_index >= script->command_count) {
+            script->command_index = 0;
+        }
+    }
+    
+    bool action_down = false;
+    if (script->command_index < script->command_count) {
+        Input_Command* command = &script->commands[script->command_index];
+        result.dir = command->dir;
+        result.jump_down = command->jump;
+        result.jump_pressed = command->jump && !script->prev_jump;
+        result.action_pressed = command->action && !script->prev_action;
+        action_down = command->action;
+        script->step_index++;
+    }
+    
+    script->prev_jump = result.jump_down;
+    script->prev_action = action_down;
+    return result;
+}
+
+/***************************************************************************
+ * Entry point
+ ***************************************************************************/
+
+inline void
+hash_bytes(u64* hash, void* data, umm size) {
+    // NOTE(Alexander): FNV-1a
+    u8* bytes = (u8*) data;
+    for (umm i = 0; i < size; i++) {
+        *hash ^= bytes[i];
+        *hash *= 1099511628211ULL;
+    }
+}
+
+// NOTE(Alexander): draws a generated tile map of increasing width with the camera
+// moving at a constant speed, the cost per frame should not depend on the width.
+void
+run_tile_benchmark(s64 frame_count) {
+    s32 level_widths[] = { 400, 2500, 10000 };
+    for (int width_index = 0; width_index < fixed_array_count(level_widths); width_index++) {
+        Game_State* game = (Game_State*) calloc(1, sizeof(Game_State));
+        init_game_state(game);
+        game->texture_tiles.width = 10*TILE_SIZE;
+        game->texture_tiles.height = 5*TILE_SIZE;
+        
+        Memory_Arena arena = {};
+        game->tile_map_width = level_widths[width_index];
+        game->tile_map_height = game->game_height;
+        game->tile_map = push_array_of_structs(&arena, game->tile_map_width*game->tile_map_height, Tile);
+        for (int y = 0; y < game->tile_map_height; y++) {
+            for (int x = 0; x < game->tile_map_width; x++) {
+                bool is_filled = y >= game->tile_map_height - 4 || (x*7 + y*3) % 11 == 0;
+                game->tile_map[y*game->tile_map_width + x] = is_filled ? (Tile) (1 + (x + y) % 40) : 0;
+            }
+        }
+        
+        f64 frame_ns[2];
+        f64 draws_per_frame[2];
+        for (int renderer = 0; renderer < 2; renderer++) {
+            s64 texture_draws = headless_stats.texture_draws;
+            f32 scroll_width = (f32) (game->tile_map_width - game->game_width);
+            
+            clock_t start_time = clock();
+            for (s64 frame_index = 0; frame_index < frame_count; frame_index++) {
+                game->camera_p = vec2(fmodf(frame_index*0.25f, scroll_width), 0.0f);
+                if (renderer == 0) {
+                    draw_tile_range(game);
+                } else {
+                    update_tile_chunks(game);
+                    draw_tile_chunks(game);
+                }
+            }
+            f64 elapsed = (f64) (clock() - start_time) / CLOCKS_PER_SEC;
+            
+            frame_ns[renderer] = elapsed*1e9 / frame_count;
+            draws_per_frame[renderer] = (f64) (headless_stats.texture_draws - texture_draws) / frame_count;
+        }
+        
+        printf("width %5d: tiles %6.0f ns/frame (%5.1f draws), chunks %6.0f ns/frame (%4.1f draws)\n",
+               game->tile_map_width, frame_ns[0], draws_per_frame[0], frame_ns[1], draws_per_frame[1]);
+        
+        clear(&arena);
+        free(game);
+    }
+}
+
+void
+get_level_tmx_filename(cstring level_filename, char* buffer, int buffer_size) {
+    string filename = string_lit(level_filename);
+    snprintf(buffer, buffer_size, "%.*s.tmx", (int) filename.count - 4, filename.data);
+}
+
+// NOTE(Alexander): times searching for the next '<' byte by byte and with find_byte,
+// and a full parse of the .tmx file.
+void
+run_tmx_file_benchmark(cstring tmx_filename, s64 iteration_count, Memory_Arena* arena) {
+    File_View file = open_file_view(tmx_filename);
+    if (!file.data) {
+        printf("error: failed to open %s\n", tmx_filename);
+        return;
+    }
+    u8* end = file.data + file.size;
+        
+    f64 search_gbps[2];
+    s64 tag_count = 0;
+    for (int method = 0; method < 2; method++) {
+        tag_count = 0;
+        clock_t start_time = clock();
+        for (s64 iteration = 0; iteration < iteration_count; iteration++) {
+            u8* scan = file.data;
+            while (true) {
+                scan = method == 0 ? find_byte_scalar(scan, end, '<') : find_byte(scan, end, '<');
+                if (scan >= end) break;
+                tag_count++;
+                scan++;
+            }
+        }
+        f64 elapsed = (f64) (clock() - start_time) / CLOCKS_PER_SEC;
+        search_gbps[method] = elapsed > 0.0 ? (f64) file.size*iteration_count / elapsed * 1e-9 : 0.0;
+    }
+    
+    clock_t start_time = clock();
+    for (s64 iteration = 0; iteration < iteration_count; iteration++) {
+        Loaded_Tmx tmx = read_tmx_map_data(file.data, end, arena);
+        assert(tmx.is_loaded);
+        clear(arena);
+    }
+    f64 parse_us = (f64) (clock() - start_time) / CLOCKS_PER_SEC * 1e6 / iteration_count;
+    
+    printf("%-22s %6.1f KB, %5lld tags: find '<' bytewise %5.2f GB/s, find_byte %5.2f GB/s, parse %7.1f us\n",
+           tmx_filename, file.size / 1024.0, (long long) (tag_count / iteration_count),
+           search_gbps[0], search_gbps[1], parse_us);
+    close_file_view(&file);
+}
+
+// NOTE(Alexander): benchmarks every shipped level, or only the given .tmx file
+void
+run_tmx_benchmark(s64 iteration_count, cstring tmx_filename) {
+    Memory_Arena arena = {};
+    if (tmx_filename) {
+        run_tmx_file_benchmark(tmx_filename, iteration_count, &arena);
+        return;
+    }
+    
+    for (int level_index = 0; level_index < fixed_array_count(level_assets); level_index++) {
+        char filename[256];
+        get_level_tmx_filename(level_assets[level_index], filename, sizeof(filename));
+        run_tmx_file_benchmark(filename, iteration_count, &arena);
+    }
+}
+
+// NOTE(Alexander): cooks every level in level_assets from the .tmx next to it,
+// run from the run_tree directory after editing a level.
+bool
+cook_level_assets() {
+    bool result = true;
+    Memory_Arena arena = {};
+    for (int level_index = 0; level_index < fixed_array_count(level_assets); level_index++) {
+        char tmx_filename[256];
+        get_level_tmx_filename(level_assets[level_index], tmx_filename, sizeof(tmx_filename));
+        
+        if (cook_level(string_lit(tmx_filename), level_assets[level_index], &arena)) {
+            printf("cooked %s -> %s (%d bytes)\n", tmx_filename, level_assets[level_index],
+                   GetFileLength(level_assets[level_index]));
+        } else {
+            printf("error: failed to cook %s\n", tmx_filename);
+            result = false;
+        }
+        clear(&arena);
+    }
+    return result;
+}
+
+void
+print_usage() {
+    printf("usage: headless [options] <level.tmx>\n"
+           "  -steps <n>       number of simulation steps to run (default 36000)\n"
+           "  -input <file>    scripted input, see Input_Script\n"
+           "  -repeat          loop the input script\n"
+           "  -expect <hash>   fail unless the run ends with this checksum\n"
+           "  -bench-tiles     benchmark the tile map renderer, uses -steps as the frame count\n"
+           "  -bench-tmx       benchmark the tmx scanner on the shipped levels or the given .tmx, uses -steps as the iteration count\n"
+           "  -cook            cook all the levels into binary .lvl files and exit\n");
+}
+
+int
+main(int argc, char** argv) {
+    s64 step_count = 36000;
+    cstring level_filename = 0;
+    cstring input_filename = 0;
+    cstring expected_checksum = 0;
+    bool repeat = false;
+    bool bench_tiles = false;
+    bool bench_tmx = false;
+    bool cook = false;
+    
+    for (int arg_index = 1; arg_index < argc; arg_index++) {
+        cstring arg = argv[arg_index];
+        if (strcmp(arg, "-steps") == 0 && arg_index + 1 < argc) {
+            step_count = atoll(argv[++arg_index]);
+        } else if (strcmp(arg, "-input") == 0 && arg_index + 1 < argc) {
+            input_filename = argv[++arg_index];
+        } else if (strcmp(arg, "-expect") == 0 && arg_index + 1 < argc) {
+            expected_checksum = argv[++arg_index];
+        } else if (strcmp(arg, "-repeat") == 0) {
+            repeat = true;
+        } else if (strcmp(arg, "-bench-tiles") == 0) {
+            bench_tiles = true;
+        } else if (strcmp(arg, "-bench-tmx") == 0) {
+            bench_tmx = true;
+        } else if (strcmp(arg, "-cook") == 0) {
+            cook = true;
+        } else if (arg[0] == '-') {
+            print_usage();
+            return 1;
+        } else {
+            level_filename = arg;
+        }
+    }
+    
+    if (cook) {
+        return cook_level_assets() ? 0 : 1;
+    }
+    
+    if (bench_tmx) {
+        run_tmx_benchmark(step_count, level_filename);
+        return 0;
+    }
+    
+    if (bench_tiles) {
+        run_tile_benchmark(step_count);
+        return 0;
+    }
+    
+    if (!level_filename) {
+        print_usage();
+        return 1;
+    }
+    
+    static Game_State game = {};
+    init_game_state(&game);
+    
+    Memory_Arena level_arena = {};
+    set_minimum_arena_block_size(&level_arena, kilobytes(256));
+    game_setup_level(&game, &level_arena, string_lit(level_filename));
+    
+    Memory_Arena script_arena = {};
+    Input_Script script = {};
+    script.repeat = repeat;
+    if (input_filename && !load_input_script(&script, input_filename, &script_arena)) {
+        printf("error: failed to load input script `%s`\n", input_filename);
+        return 1;
+    }
+    
+    u64 checksum = 14695981039346656037ULL;
+    s32 deaths = 0;
+    
+    clock_t start_time = clock();
+    for (s64 step_index = 0; step_index < step_count; step_index++) {
+        Game_Controller controller = next_scripted_input(&script);
+        clear(&game.frame_arena);
+        
+        simulate(&game, &controller);
+        if (game.mode == GameMode_Death_Screen) {
+            deaths++;
+        }
+        
+        hash_bytes(&checksum, &get_entity_collider(&game, game.player)->p, sizeof(v2));
+        hash_bytes(&checksum, &game.coins, sizeof(game.coins));
+        hash_bytes(&checksum, &game.mode, sizeof(game.mode));
+    }
+    f64 elapsed = (f64) (clock() - start_time) / CLOCKS_PER_SEC;
+    
+    printf("level:    %s\n", level_filename);
+    printf("steps:    %lld in %.3f s (%.0f steps/s)\n", (long long) step_count, elapsed,
+           elapsed > 0.0 ? step_count / elapsed : 0.0);
+    v2 player_p = get_entity_collider(&game, game.player)->p;
+    printf("player:   p=(%.3f, %.3f) coins=%d/%d deaths=%d\n",
+           player_p.x, player_p.y, game.coins, game.max_coins, deaths);
+    printf("sounds:   %lld\n", (long long) headless_stats.sounds_played);
+    printf("checksum: %016llx\n", (unsigned long long) checksum);
+    
+    if (expected_checksum) {
+        u64 expected = strtoull(expected_checksum, 0, 16);
+        if (expected != checksum) {
+            printf("error: checksum mismatch, expected %016llx\n", (unsigned long long) expected);
+            return 1;
+        }
+    }
+    
+    return 0;
+}
@@ -1,8 +1,74 @@
 #include <math.h>
 
-f32
-random_f32() {
-    return (f32) rand() / (RAND_MAX + 1.0f);
+// NOTE(Alexander): four independent xorshift32 generators, the bulk fill steps all four
+// lanes at once and the scalar version takes the lanes in turn. Both give the same
+// values with and without SSE2 so a seed always plays back the same way.
+struct Random_Series {
+    u32 lanes[4];
+    u32 next_lane;
+};
+
+inline Random_Series
+random_seed(u32 seed) {
+    Random_Series series = {};
+    for (int lane = 0; lane < 4; lane++) {
+        // splitmix32 to spread the seed, xorshift must never start at zero
+        u32 z = seed + 0x9E3779B9u*(lane + 1);
+        z = (z ^ (z >> 16))*0x85EBCA6Bu;
+        z = (z ^ (z >> 13))*0xC2B2AE35u;
+        z ^= z >> 16;
+        series.lanes[lane] = z ? z : 0x6D2B79F5u;
+    }
+    return series;
+}
+
+inline u32
+xorshift32(u32 x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+inline u32
+random_u32(Random_Series* series) {
+    u32* lane = &series->lanes[series->next_lane];
+    series->next_lane = (series->next_lane + 1) & 3;
+    *lane = xorshift32(*lane);
+    return *lane;
+}
+
+// Returns a random number in [0, 1)
+inline f32
+random_f32(Random_Series* series) {
+    return (f32) (random_u32(series) >> 8) * (1.0f / 16777216.0f);
+}
+
+void
+random_f32_array(Random_Series* series, f32* dest, int count) {
+    int index = 0;
+#if USE_SSE2
+    __m128i x = _mm_loadu_si128((__m128i*) series->lanes);
+    __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+    for (; index + 4 <= count; index += 4) {
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+        x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+        x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+        __m128 r = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(x, 8)), scale);
+        _mm_storeu_ps(dest + index, r);
+    }
+    _mm_storeu_si128((__m128i*) series->lanes, x);
+#else
+    for (; index + 4 <= count; index += 4) {
+        for (int lane = 0; lane < 4; lane++) {
+            series->lanes[lane] = xorshift32(series->lanes[lane]);
+            dest[index + lane] = (f32) (series->lanes[lane] >> 8) * (1.0f / 16777216.0f);
+        }
+    }
+#endif
+    for (; index < count; index++) {
+        dest[index] = random_f32(series);
+    }
 }
 
 f32
@@ -322,6 +388,11 @@ operator==(v2 a, v2 b) {
     return (a.x == b.x) && (a.y == b.y);
 }
 
+inline v2
+lerp(v2 a, v2 b, f32 t) {
+    return a*(1.0f - t) + b*t;
+}
+
 inline v2
 abs(v2 v) {
     v2 result = vec2(fabsf(v.x), fabsf(v.y));
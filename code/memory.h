@@ -9,6 +9,11 @@
 #endif
 #define ARENA_DEFAULT_BLOCK_SIZE kilobytes(32)
 
+enum Push_Flags {
+    PushFlag_None = 0,
+    PushFlag_NoClear = bit(0), // caller overwrites the whole allocation
+};
+
 // TODO(Alexander): special asserts
 #define assert_enum(T, v) assert((v) > 0 && (v) < T##_Count && "enum value out of range")
 #define assert_power_of_two(x) assert((((x) & ((x) - 1)) == 0) && "x is not power of two")
@@ -25,12 +30,41 @@ align_forward(umm address, umm align) {
     return address;
 }
 
+// NOTE(Alexander): each block allocated by the arena ends with a footer that links
+// back to the block that was current before it, blocks are chained newest first.
+struct Memory_Block_Footer {
+    u8* prev_base;
+    umm prev_size;
+    umm prev_used;
+    umm prev_dirty_size;
+};
+
 struct Memory_Arena {
     u8* base;
     umm size;
     umm curr_used;
     umm prev_used;
     umm min_block_size;
+    
+    // NOTE(Alexander): blocks are zeroed once when they are allocated or recycled, only
+    // memory below the dirty watermark can hold old data and needs clearing on push.
+    umm dirty_size;
+    
+    s32 block_count;
+    s32 temp_count;
+    
+    // NOTE(Alexander): blocks released by clear/end_temporary_memory, linked through
+    // their footers prev_base/prev_size, reused before calling calloc again.
+    // A free block keeps its own dirty watermark in prev_dirty_size.
+    u8* free_base;
+    umm free_size;
+};
+
+struct Temp_Memory {
+    Memory_Arena* arena;
+    u8* base;
+    umm used;
+    s32 block_count;
 };
 
 inline void
@@ -40,6 +74,8 @@ set_specific_arena_block(Memory_Arena* arena, u8* base, umm size) {
     arena->curr_used = 0;
     arena->prev_used = 0;
     arena->min_block_size = size;
+    arena->dirty_size = size; // NOTE(Alexander): we don't know what the caller gave us
+    arena->block_count = 1;
     //pln("arena->base = %", arena->base);
 }
 
@@ -50,32 +86,100 @@ set_minimum_arena_block_size(Memory_Arena* arena, umm min_block_size=0) {
     arena->min_block_size = min_block_size;
 }
 
+inline Memory_Block_Footer*
+get_block_footer(u8* base, umm size) {
+    return (Memory_Block_Footer*) (base + size);
+}
+
+// NOTE(Alexander): moves the current block to the free list and makes the previous block current
+inline void
+release_arena_block(Memory_Arena* arena) {
+    assert(arena->block_count > 1 && "the first block is never released");
+    Memory_Block_Footer* footer = get_block_footer(arena->base, arena->size);
+    u8* prev_base = footer->prev_base;
+    umm prev_size = footer->prev_size;
+    umm prev_used = footer->prev_used;
+    umm prev_dirty_size = footer->prev_dirty_size;
+    
+    footer->prev_base = arena->free_base;
+    footer->prev_size = arena->free_size;
+    footer->prev_dirty_size = arena->dirty_size;
+    arena->free_base = arena->base;
+    arena->free_size = arena->size;
+    
+    arena->base = prev_base;
+    arena->size = prev_size;
+    arena->curr_used = prev_used;
+    arena->prev_used = prev_used;
+    arena->dirty_size = prev_dirty_size;
+    arena->block_count--;
+}
+
+void
+push_arena_block(Memory_Arena* arena, umm min_size) {
+    if (arena->min_block_size == 0) {
+        arena->min_block_size = ARENA_DEFAULT_BLOCK_SIZE;
+    }
+    
+    // NOTE(Alexander): first try to recycle a previously released block that is large enough
+    u8* base = 0;
+    umm size = 0;
+    u8** link_base = &arena->free_base;
+    umm* link_size = &arena->free_size;
+    while (*link_base) {
+        Memory_Block_Footer* free_footer = get_block_footer(*link_base, *link_size);
+        if (*link_size >= min_size) {
+            base = *link_base;
+            size = *link_size;
+            *link_base = free_footer->prev_base;
+            *link_size = free_footer->prev_size;
+            memset(base, 0, free_footer->prev_dirty_size);
+            break;
+        }
+        link_base = &free_footer->prev_base;
+        link_size = &free_footer->prev_size;
+    }
+    
+    if (!base) {
+        size = align_forward(max(min_size, arena->min_block_size), alignof(Memory_Block_Footer));
+        base = (u8*) calloc(1, size + sizeof(Memory_Block_Footer));
+        assert(base && "failed to allocate arena block");
+    }
+    
+    Memory_Block_Footer* footer = get_block_footer(base, size);
+    footer->prev_base = arena->base;
+    footer->prev_size = arena->size;
+    footer->prev_used = arena->curr_used;
+    footer->prev_dirty_size = arena->dirty_size;
+    
+    arena->base = base;
+    arena->size = size;
+    arena->curr_used = 0;
+    arena->prev_used = 0;
+    arena->dirty_size = 0;
+    arena->block_count++;
+}
+
 void*
 push_size(Memory_Arena* arena, umm size, umm align=DEFAULT_ALIGNMENT, umm flags=0) {
     umm current = (umm) (arena->base + arena->curr_used);
     umm offset = align_forward(current, align) - (umm) arena->base;
     
-    if (offset + size > arena->size) {
-        if (arena->min_block_size == 0) {
-            arena->min_block_size = ARENA_DEFAULT_BLOCK_SIZE;
-        }
-        
-        assert(!arena->base && "reach end of initial arena block allocation");
-        arena->base = (u8*) calloc(1, arena->min_block_size);
-        arena->curr_used = 0;
-        arena->prev_used = 0;
-        arena->size = arena->min_block_size;
+    if (!arena->base || offset + size > arena->size) {
+        push_arena_block(arena, size + align);
         
         current = (umm) arena->base + arena->curr_used;
         offset = align_forward(current, align) - (umm) arena->base;
-        // TODO(Alexander): we need to also store the previous memory block so we can eventually free it.
     }
     
     void* result = arena->base + offset;
     arena->prev_used = arena->curr_used;
     arena->curr_used = offset + size;
     
-    memset(result, 0, size);
+    if (!(flags & PushFlag_NoClear) && offset < arena->dirty_size) {
+        memset(result, 0, min(size, arena->dirty_size - offset));
+    }
+    arena->dirty_size = max(arena->dirty_size, arena->curr_used);
     
     //pln("push_size(%) = %", size, result);
     
@@ -85,22 +189,68 @@ push_size(Memory_Arena* arena, umm size, umm align=DEFAULT_ALIGNMENT, umm flags=
 
 string
 push_string(Memory_Arena* arena, string s) {
-    void* data = push_size(arena, s.count, 1);
+    void* data = push_size(arena, s.count, 1, PushFlag_NoClear);
     memcpy(data, s.data, s.count);
     s.data = (u8*) data;
     return s;
 }
 
-#define push_struct(arena, type) (type*) push_size(arena, sizeof(type), alignof(type))
-#define push_array_of_structs(arena, count, type) (type*) push_size(arena, count*sizeof(type), alignof(type))
+// NOTE(Alexander): formats into the arena, the result is null terminated
+cstring
+push_format_cstring(Memory_Arena* arena, cstring format, ...) {
+    va_list args;
+    va_start(args, format);
+    int count = vsnprintf(0, 0, format, args);
+    va_end(args);
+    
+    char* result = (char*) push_size(arena, count + 1, 1, PushFlag_NoClear);
+    va_start(args, format);
+    vsnprintf(result, count + 1, format, args);
+    va_end(args);
+    return result;
+}
+
+#define push_struct(arena, type, ...) (type*) push_size(arena, sizeof(type), alignof(type), ##__VA_ARGS__)
+#define push_array_of_structs(arena, count, type, ...) (type*) push_size(arena, (count)*sizeof(type), alignof(type), ##__VA_ARGS__)
 
 inline void
 arena_rewind(Memory_Arena* arena) {
     arena->curr_used = arena->prev_used;
 }
 
+inline Temp_Memory
+begin_temporary_memory(Memory_Arena* arena) {
+    Temp_Memory result;
+    result.arena = arena;
+    result.base = arena->base;
+    result.used = arena->curr_used;
+    result.block_count = arena->block_count;
+    arena->temp_count++;
+    return result;
+}
+
+inline void
+end_temporary_memory(Temp_Memory temp) {
+    Memory_Arena* arena = temp.arena;
+    // NOTE(Alexander): the first block is kept even if it was allocated inside the scope
+    while (arena->block_count > max(temp.block_count, 1)) {
+        release_arena_block(arena);
+    }
+    
+    assert((temp.block_count == 0 || arena->base == temp.base) && arena->curr_used >= temp.used &&
+           "mismatched temporary memory");
+    arena->curr_used = temp.used;
+    arena->prev_used = temp.used;
+    assert(arena->temp_count > 0);
+    arena->temp_count--;
+}
+
 inline void
 clear(Memory_Arena* arena) {
+    assert(arena->temp_count == 0 && "clearing arena with temporary memory in use");
+    while (arena->block_count > 1) {
+        release_arena_block(arena);
+    }
     arena->curr_used = 0;
     arena->prev_used = 0;
 }
@@ -1,69 +1,224 @@
+Particle_Pool*
+init_particle_pool(int max_particle_count, u32 seed) {
+    Particle_Pool* pool = (Particle_Pool*) calloc(1, sizeof(Particle_Pool));
+    
+    umm array_count = (max_particle_count + 3) & ~3;
+    umm array_size = array_count*sizeof(f32);
+    u8* memory = (u8*) calloc(1, 5*array_size + array_count + 15);
+    f32* base = (f32*) align_forward((umm) memory, 16);
+    pool->px = base;
+    pool->py = base + array_count;
+    pool->vx = base + 2*array_count;
+    pool->vy = base + 3*array_count;
+    pool->t  = base + 4*array_count;
+    pool->emitter = (u8*) (base + 5*array_count);
+    pool->max_particle_count = max_particle_count;
+    
+    pool->seed = seed;
+    pool->entropy = random_seed(seed);
+    for (int step = 0; step < PARTICLE_ANGLE_STEPS; step++) {
+        f32 a = (f32) step * (2.0f*PI_F32 / PARTICLE_ANGLE_STEPS);
+        pool->cos_table[step] = cosf(a);
+        pool->sin_table[step] = sinf(a);
+    }
+    return pool;
+}
 
-Particle_System*
-init_particle_system(int max_particle_count) {
-    Particle_System* ps = (Particle_System*) calloc(1, sizeof(Particle_System));
-    ps->particles = (Particle*) malloc(max_particle_count * sizeof(Particle));
-    ps->max_particle_count = max_particle_count;
-    return ps;
+Particle_Emitter*
+add_particle_emitter(Particle_Pool* pool, int max_particle_count, Color* colors, int color_count) {
+    assert(pool->emitter_count < MAX_PARTICLE_EMITTERS && "too many particle emitters");
+    Particle_Emitter* emitter = &pool->emitters[pool->emitter_count];
+    emitter->index = (u8) pool->emitter_count++;
+    emitter->max_particle_count = max_particle_count;
+    emitter->colors = colors;
+    emitter->color_count = color_count;
+    return emitter;
+}
+
+inline void
+move_particle(Particle_Pool* pool, int dest, int src) {
+    pool->px[dest] = pool->px[src];
+    pool->py[dest] = pool->py[src];
+    pool->vx[dest] = pool->vx[src];
+    pool->vy[dest] = pool->vy[src];
+    pool->t[dest] = pool->t[src];
+    pool->emitter[dest] = pool->emitter[src];
+}
+
+inline void
+integrate_particle(Particle_Pool* pool, int dest, int src, f32 delta_t) {
+    pool->px[dest] = pool->px[src] + pool->vx[src];
+    pool->py[dest] = pool->py[src] + pool->vy[src];
+    pool->vx[dest] = pool->vx[src];
+    pool->vy[dest] = pool->vy[src];
+    pool->t[dest] = max(pool->t[src] - delta_t, 0.0f);
+    pool->emitter[dest] = pool->emitter[src];
 }
 
 void
-reset_particle_system(Particle_System* ps) {
-    int max_particle_count = ps->max_particle_count;
-    Particle* particles = ps->particles;
-    *ps = {};
-    ps->max_particle_count = max_particle_count;
-    ps->particles = particles;
+reset_particle_pool(Particle_Pool* pool) {
+    pool->particle_count = 0;
+    pool->entropy = random_seed(pool->seed);
+    for (int emitter_index = 0; emitter_index < pool->emitter_count; emitter_index++) {
+        pool->emitters[emitter_index].particle_count = 0;
+    }
 }
 
 void
-particle_burst(Particle_System* ps, int max_num_particles, f32 spawn_rate) {
+particle_burst(Particle_Pool* pool, Particle_Emitter* emitter, int max_num_particles, f32 spawn_rate) {
+    // NOTE(Alexander): random numbers are filled in bulk, five per particle for the spawn
+    // chance, position x and y, angle and speed.
+    const int chunk_size = 64;
+    f32 random[5*chunk_size];
+    
+    v2 rand_box = emitter->start_max_p - emitter->start_min_p;
+    f32 angle_range = emitter->max_angle - emitter->min_angle;
+    f32 speed_range = emitter->max_speed - emitter->min_speed;
+    f32 angle_to_step = PARTICLE_ANGLE_STEPS / (2.0f*PI_F32);
+    
     // Spawn new particles
-    for (int i = 0; i < max_num_particles; i++) {
-        if (ps->particle_count < ps->max_particle_count && random_f32() < spawn_rate) {
-            Particle* p = &ps->particles[ps->particle_count];
-            ps->particle_count++;
-            v2 rand_box = ps->start_max_p - ps->start_min_p;
-            rand_box.x *= random_f32();
-            rand_box.y *= random_f32();
-            p->p = ps->start_min_p + rand_box;
+    for (int first = 0; first < max_num_particles; first += chunk_size) {
+        int count = min(chunk_size, max_num_particles - first);
+        random_f32_array(&pool->entropy, random, 5*count);
+        
+        for (int i = 0; i < count; i++) {
+            if (emitter->particle_count >= emitter->max_particle_count ||
+                pool->particle_count >= pool->max_particle_count) {
+                return;
+            }
+            
+            f32* r = random + 5*i;
+            if (r[0] >= spawn_rate) continue;
             
-            f32 a = ps->min_angle + random_f32() * (ps->max_angle - ps->min_angle);
-            f32 speed = ps->min_speed + random_f32() * (ps->max_speed - ps->min_speed);
-            p->v.x = cosf(a)*speed;
-            p->v.y = sinf(a)*speed;
+            int index = pool->particle_count++;
+            emitter->particle_count++;
+            pool->px[index] = emitter->start_min_p.x + rand_box.x*r[1];
+            pool->py[index] = emitter->start_min_p.y + rand_box.y*r[2];
             
-            p->t = 1.0f;
+            f32 a = emitter->min_angle + r[3]*angle_range;
+            int step = (int) floorf(a*angle_to_step + 0.5f) & (PARTICLE_ANGLE_STEPS - 1);
+            f32 speed = emitter->min_speed + r[4]*speed_range;
+            pool->vx[index] = pool->cos_table[step]*speed;
+            pool->vy[index] = pool->sin_table[step]*speed;
+            
+            pool->t[index] = 1.0f;
+            pool->emitter[index] = emitter->index;
         }
     }
 }
 
 void
-update_particle_system(Particle_System* ps, bool spawn_new) {
-    // Remove dead particles
-    for (int i = 0; i < ps->particle_count; i++) {
-        Particle* p = &ps->particles[i];
-        if (p->t <= 0.0f) {
-            if (ps->particle_count > 0) {
-                Particle* last = &ps->particles[ps->particle_count - 1];
-                *p = *last;
-                i--;
+spawn_particle_effect(Particle_Pool* pool, Particle_Emitter* emitter, v2 p, int count) {
+    emitter->start_min_p = p - vec2(0.25f, 0.25f);
+    emitter->start_max_p = p + vec2(0.25f, 0.25f);
+    particle_burst(pool, emitter, count, 1.0f);
+}
+
+void
+add_particle_velocity(Particle_Pool* pool, Particle_Emitter* emitter, v2 velocity) {
+    for_emitter_particle(pool, emitter, index) {
+        pool->vx[index] += velocity.x;
+        pool->vy[index] += velocity.y;
+    }
+}
+
+void
+update_particles(Particle_Pool* pool, u32 emitter_mask) {
+    // NOTE(Alexander): integrate, age and remove dead particles of every emitter in the mask
+    // in one pass over the pool, particles of other emitters are kept as they are. Live
+    // particles are moved down in place so the arrays stay packed and in spawn order.
+    alignas(16) f32 delta_t[MAX_PARTICLE_EMITTERS] = {};
+    alignas(16) s32 update[MAX_PARTICLE_EMITTERS] = {};
+    for (int emitter_index = 0; emitter_index < pool->emitter_count; emitter_index++) {
+        Particle_Emitter* emitter = &pool->emitters[emitter_index];
+        if (emitter_mask & emitter_bit(emitter)) {
+            delta_t[emitter_index] = emitter->delta_t;
+            update[emitter_index] = -1;
+        }
+        emitter->particle_count = 0;
+    }
+    
+    int live_count = 0;
+    int index = 0;
+    
+#if USE_SSE2
+    __m128 zero = _mm_setzero_ps();
+    for (; index + 4 <= pool->particle_count; index += 4) {
+        u8* e = pool->emitter + index;
+        __m128 update_lanes = _mm_castsi128_ps(_mm_setr_epi32(update[e[0]], update[e[1]],
+                                                              update[e[2]], update[e[3]]));
+        __m128 dt = _mm_setr_ps(delta_t[e[0]], delta_t[e[1]], delta_t[e[2]], delta_t[e[3]]);
+        
+        __m128 t = _mm_load_ps(pool->t + index);
+        int keep_mask = _mm_movemask_ps(_mm_cmpgt_ps(t, zero)) | (~_mm_movemask_ps(update_lanes) & 0xF);
+        if (keep_mask == 0) continue;
+        
+        __m128 vx = _mm_load_ps(pool->vx + index);
+        __m128 vy = _mm_load_ps(pool->vy + index);
+        __m128 px = _mm_add_ps(_mm_load_ps(pool->px + index), _mm_and_ps(vx, update_lanes));
+        __m128 py = _mm_add_ps(_mm_load_ps(pool->py + index), _mm_and_ps(vy, update_lanes));
+        t = _mm_max_ps(_mm_sub_ps(t, dt), zero);
+        
+        if (keep_mask == 0xF) {
+            _mm_storeu_ps(pool->px + live_count, px);
+            _mm_storeu_ps(pool->py + live_count, py);
+            _mm_storeu_ps(pool->vx + live_count, vx);
+            _mm_storeu_ps(pool->vy + live_count, vy);
+            _mm_storeu_ps(pool->t + live_count, t);
+            for (int lane = 0; lane < 4; lane++) {
+                u8 emitter_index = e[lane];
+                pool->emitters[emitter_index].particle_count++;
+                pool->emitter[live_count++] = emitter_index;
+            }
+            continue;
+        }
+        
+        alignas(16) f32 lanes[5][4];
+        _mm_store_ps(lanes[0], px);
+        _mm_store_ps(lanes[1], py);
+        _mm_store_ps(lanes[2], vx);
+        _mm_store_ps(lanes[3], vy);
+        _mm_store_ps(lanes[4], t);
+        for (int lane = 0; lane < 4; lane++) {
+            if (keep_mask & bit(lane)) {
+                u8 emitter_index = e[lane];
+                pool->emitters[emitter_index].particle_count++;
+                pool->px[live_count] = lanes[0][lane];
+                pool->py[live_count] = lanes[1][lane];
+                pool->vx[live_count] = lanes[2][lane];
+                pool->vy[live_count] = lanes[3][lane];
+                pool->t[live_count] = lanes[4][lane];
+                pool->emitter[live_count] = emitter_index;
+                live_count++;
             }
-            ps->particle_count--;
         }
     }
+#endif
     
-    if (spawn_new) {
-        particle_burst(ps, 10, ps->spawn_rate);
+    for (; index < pool->particle_count; index++) {
+        u8 emitter_index = pool->emitter[index];
+        if (update[emitter_index]) {
+            if (pool->t[index] <= 0.0f) continue;
+            integrate_particle(pool, live_count, index, delta_t[emitter_index]);
+        } else {
+            move_particle(pool, live_count, index);
+        }
+        pool->emitters[emitter_index].particle_count++;
+        live_count++;
     }
+    pool->particle_count = live_count;
+}
+
+void
+update_particle_emitter(Particle_Pool* pool, Particle_Emitter* emitter, bool spawn_new) {
+    update_particles(pool, emitter_bit(emitter));
     
-    // Update live particles
-    for (int i = 0; i < ps->particle_count; i++) {
-        Particle* p = &ps->particles[i];
-        p->p += p->v;
-        p->t -= ps->delta_t;
-        if (p->t < 0) {
-            p->t = 0;
+    if (spawn_new) {
+        // New particles take their first step right away
+        int first_new = pool->particle_count;
+        particle_burst(pool, emitter, 10, emitter->spawn_rate);
+        for (int new_index = first_new; new_index < pool->particle_count; new_index++) {
+            integrate_particle(pool, new_index, new_index, emitter->delta_t);
         }
     }
-}
\ No newline at end of file
+}
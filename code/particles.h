@@ -1,14 +1,17 @@
+// NOTE(Alexander): particles are stored as a structure of arrays so the update kernel
+// can work on four particles at a time, each array is 16 byte aligned and padded
+// to a multiple of four.
+#define MAX_PARTICLE_EMITTERS 16
+#define PARTICLE_POOL_SIZE 4096
+#define PARTICLE_ANGLE_STEPS 1024
+#define PARTICLE_SEED 0x47524156u
 
-struct Particle {
-    v2 p;
-    v2 v;
-    f32 t;
-};
-
-struct Particle_System {
-    Particle* particles;
-    int max_particle_count;
+// NOTE(Alexander): an emitter is only a parameter block and a budget, the particles
+// themselves live in the pool shared by all emitters.
+struct Particle_Emitter {
+    u8 index;
     int particle_count;
+    int max_particle_count;
     
     v2 start_min_p;
     v2 start_max_p;
@@ -24,12 +27,42 @@ struct Particle_System {
     
     f32 spawn_rate;
     f32 delta_t;
+    
+    Color* colors;
+    int color_count;
+};
+
+struct Particle_Pool {
+    f32* px;
+    f32* py;
+    f32* vx;
+    f32* vy;
+    f32* t;
+    u8* emitter;
+    int max_particle_count;
+    int particle_count;
+    
+    Particle_Emitter emitters[MAX_PARTICLE_EMITTERS];
+    int emitter_count;
+    
+    // NOTE(Alexander): the pool is reseeded on reset so effects play back the same way
+    // every time a level is restarted.
+    Random_Series entropy;
+    u32 seed;
+    
+    // Direction for each angle step around the circle, spawning looks these up
+    // instead of calling cosf and sinf for every particle.
+    f32 cos_table[PARTICLE_ANGLE_STEPS];
+    f32 sin_table[PARTICLE_ANGLE_STEPS];
 };
 
-#define for_particle(ps, it, it_index) \
-int it_index = 0; \
-for (Particle* it = ps->particles; \
-it_index < ps->particle_count; \
-it_index++, it++)
+#define emitter_bit(emitter) (1u << (emitter)->index)
+#define ALL_PARTICLE_EMITTERS 0xFFFFFFFFu
+
+#define for_particle(pool, it_index) \
+for (int it_index = 0; it_index < (pool)->particle_count; it_index++)
+
+#define for_emitter_particle(pool, em, it_index) \
+for_particle(pool, it_index) if ((pool)->emitter[it_index] == (em)->index)
 
-void reset_particle_system(Particle_System* ps);
\ No newline at end of file
+void reset_particle_pool(Particle_Pool* pool);
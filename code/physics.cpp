@@ -12,61 +12,223 @@ box_check(Box a, Box b) {
     return box_check(a.p, a.p + a.size, b.p, b.p + b.size);
 }
 
+struct Grid_Cell_Range {
+    s32 min_x;
+    s32 min_y;
+    s32 max_x;
+    s32 max_y;
+};
+
+inline Grid_Cell_Range
+get_grid_cell_range(Spatial_Grid* grid, Box box) {
+    Grid_Cell_Range result;
+    result.min_x = (s32) floorf(box.p.x / GRID_CELL_SIZE);
+    result.min_y = (s32) floorf(box.p.y / GRID_CELL_SIZE);
+    result.max_x = (s32) floorf((box.p.x + box.size.x) / GRID_CELL_SIZE);
+    result.max_y = (s32) floorf((box.p.y + box.size.y) / GRID_CELL_SIZE);
+    
+    // NOTE(Alexander): anything outside the map is clamped into the border cells
+    result.min_x = clamp(result.min_x, 0, grid->width - 1);
+    result.min_y = clamp(result.min_y, 0, grid->height - 1);
+    result.max_x = clamp(result.max_x, 0, grid->width - 1);
+    result.max_y = clamp(result.max_y, 0, grid->height - 1);
+    return result;
+}
+
+inline s32
+get_max_grid_cell_count(v2 size) {
+    // NOTE(Alexander): a box can straddle one extra cell on each axis depending on its position
+    s32 x_count = (s32) (size.x / GRID_CELL_SIZE) + 2;
+    s32 y_count = (s32) (size.y / GRID_CELL_SIZE) + 2;
+    return x_count*y_count;
+}
+
+Box
+get_broadphase_box(Game_State* game, Entity* entity) {
+    Box* collider = get_entity_collider(game, entity);
+    
+    // NOTE(Alexander): triggers are tested without offset and solids with offset, so cover both
+    v2 min_p = collider->p + vec2(min(entity->offset.x, 0.0f), min(entity->offset.y, 0.0f));
+    v2 max_p = collider->p + collider->size + vec2(max(entity->offset.x, 0.0f), max(entity->offset.y, 0.0f));
+    
+    if (entity->type == Vine) {
+        // NOTE(Alexander): vines grow during the update, reserve the fully expanded size
+        min_p.x = min(min_p.x, collider->p.x - 5.0f);
+        max_p.x = max(max_p.x, collider->p.x + 6.0f);
+    }
+    
+    Box result;
+    result.p = min_p - GRID_MARGIN;
+    result.size = max_p - min_p + 2.0f*GRID_MARGIN;
+    return result;
+}
+
+void
+init_spatial_grid(Game_State* game, Memory_Arena* arena) {
+    Spatial_Grid* grid = &game->grid;
+    *grid = {};
+    grid->width = max((game->tile_map_width + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE, 1);
+    grid->height = max((game->tile_map_height + GRID_CELL_SIZE - 1) / GRID_CELL_SIZE, 1);
+    
+    s32 cell_count = grid->width*grid->height;
+    grid->static_cells = push_array_of_structs(arena, cell_count, s32, PushFlag_NoClear);
+    grid->dynamic_cells = push_array_of_structs(arena, cell_count, s32, PushFlag_NoClear);
+    for (s32 cell_index = 0; cell_index < cell_count; cell_index++) {
+        grid->static_cells[cell_index] = -1;
+        grid->dynamic_cells[cell_index] = -1;
+    }
+    
+    // Static colliders never move so they are only inserted once
+    for (int col_index = 0; col_index < game->collider_count; col_index++) {
+        grid->max_static_entry_count += get_max_grid_cell_count(game->colliders[col_index].size);
+    }
+    grid->static_entries = push_array_of_structs(arena, grid->max_static_entry_count, Spatial_Grid_Entry,
+                                                   PushFlag_NoClear);
+    
+    for (int col_index = 0; col_index < game->collider_count; col_index++) {
+        Grid_Cell_Range range = get_grid_cell_range(grid, game->colliders[col_index]);
+        for (s32 y = range.min_y; y <= range.max_y; y++) {
+            for (s32 x = range.min_x; x <= range.max_x; x++) {
+                s32* cell = &grid->static_cells[y*grid->width + x];
+                assert(grid->static_entry_count < grid->max_static_entry_count);
+                Spatial_Grid_Entry* entry = &grid->static_entries[grid->static_entry_count];
+                entry->index = col_index;
+                entry->next = *cell;
+                *cell = grid->static_entry_count++;
+            }
+        }
+    }
+    
+    // Reserve enough entries for dynamic entities, these are re-bucketed every frame
+    for (int entity_index = 0; entity_index < game->entity_count; entity_index++) {
+        Box box = get_broadphase_box(game, &game->entities[entity_index]);
+        grid->max_dynamic_entry_count += get_max_grid_cell_count(box.size);
+    }
+    grid->dynamic_entries = push_array_of_structs(arena, grid->max_dynamic_entry_count, Spatial_Grid_Entry,
+                                                    PushFlag_NoClear);
+}
+
+void
+update_spatial_grid(Game_State* game) {
+    Spatial_Grid* grid = &game->grid;
+    s32 cell_count = grid->width*grid->height;
+    for (s32 cell_index = 0; cell_index < cell_count; cell_index++) {
+        grid->dynamic_cells[cell_index] = -1;
+    }
+    grid->dynamic_entry_count = 0;
+    
+    // NOTE(Alexander): entities are bucketed by spawn id so the queries return them in spawn order
+    for (int spawn_id = 0; spawn_id < game->spawned_entity_count; spawn_id++) {
+        Entity* entity = get_entity_by_spawn_id(game, spawn_id);
+        if (entity->type == None) continue;
+        
+        Grid_Cell_Range range = get_grid_cell_range(grid, get_broadphase_box(game, entity));
+        for (s32 y = range.min_y; y <= range.max_y; y++) {
+            for (s32 x = range.min_x; x <= range.max_x; x++) {
+                if (grid->dynamic_entry_count >= grid->max_dynamic_entry_count) {
+                    assert(0 && "too many dynamic grid entries");
+                    return;
+                }
+                
+                s32* cell = &grid->dynamic_cells[y*grid->width + x];
+                Spatial_Grid_Entry* entry = &grid->dynamic_entries[grid->dynamic_entry_count];
+                entry->index = spawn_id;
+                entry->next = *cell;
+                *cell = grid->dynamic_entry_count++;
+            }
+        }
+    }
+}
+
+int
+query_spatial_grid(Spatial_Grid* grid, s32* cells, Spatial_Grid_Entry* entries, Box box, 
+                   s32* result, int max_result_count) {
+    int count = 0;
+    
+    Grid_Cell_Range range = get_grid_cell_range(grid, box);
+    for (s32 y = range.min_y; y <= range.max_y; y++) {
+        for (s32 x = range.min_x; x <= range.max_x; x++) {
+            for (s32 it = cells[y*grid->width + x]; it != -1; it = entries[it].next) {
+                s32 index = entries[it].index;
+                
+                // NOTE(Alexander): keep the result sorted and unique so collisions
+                // are resolved in the same order as iterating over all of them.
+                int insert_index = count;
+                while (insert_index > 0 && result[insert_index - 1] > index) {
+                    insert_index--;
+                }
+                if (insert_index > 0 && result[insert_index - 1] == index) continue;
+                
+                if (count >= max_result_count) {
+                    assert(0 && "too many broadphase candidates");
+                    return count;
+                }
+                
+                memmove(result + insert_index + 1, result + insert_index, (count - insert_index)*sizeof(s32));
+                result[insert_index] = index;
+                count++;
+            }
+        }
+    }
+    
+    return count;
+}
+
 #define SKIN_WIDTH 0.0f
 
 Collision
-box_collision(Entity* rigidbody, Box other, v2* step_velocity, bool resolve, Collision mask) {
+box_collision(Box* body, v2* velocity, Entity_Flags* flags, Box other, v2* step_velocity, bool resolve, Collision mask) {
     Collision found = Col_None;
     
-    v2 step_position = rigidbody->p + *step_velocity;
-    if (step_position.y + rigidbody->size.y > other.p.y && 
+    v2 step_position = body->p + *step_velocity;
+    if (step_position.y + body->size.y > other.p.y && 
         step_position.y < other.p.y + other.size.y) {
         
-        if (mask & Col_Left && step_velocity->x < 0.0f && rigidbody->p.x >= other.p.x + other.size.x) {
+        if (mask & Col_Left && step_velocity->x < 0.0f && body->p.x >= other.p.x + other.size.x) {
             f32 x_overlap = other.p.x + other.size.x - step_position.x;
             if (x_overlap > 0.0f) {
                 if (resolve) {
-                    step_velocity->x = other.p.x + other.size.x - rigidbody->p.x;
-                    rigidbody->velocity.x = 0.0f;
+                    step_velocity->x = other.p.x + other.size.x - body->p.x;
+                    velocity->x = 0.0f;
                 }
                 
                 found = Col_Left;
             }
-        } else if (mask & Col_Right && step_velocity->x > 0.0f && rigidbody->p.x + rigidbody->size.x <= other.p.x) {
-            f32 x_overlap = step_position.x - other.p.x + rigidbody->size.x;
+        } else if (mask & Col_Right && step_velocity->x > 0.0f && body->p.x + body->size.x <= other.p.x) {
+            f32 x_overlap = step_position.x - other.p.x + body->size.x;
             if (x_overlap > 0.0f) {
                 if (resolve) {
-                    step_velocity->x = other.p.x - rigidbody->size.x - rigidbody->p.x;
-                    rigidbody->velocity.x = 0.0f;
+                    step_velocity->x = other.p.x - body->size.x - body->p.x;
+                    velocity->x = 0.0f;
                 }
                 found = Col_Right;
             }
         }
     }
     
-    if (rigidbody->p.x + rigidbody->size.x > other.p.x && 
-        rigidbody->p.x < other.p.x + other.size.x) {
-        if (mask & Col_Top && step_velocity->y < 0.0f && rigidbody->p.y <= other.p.y + other.size.y &&
-            rigidbody->p.y + rigidbody->size.y > other.p.y) {
+    if (body->p.x + body->size.x > other.p.x && 
+        body->p.x < other.p.x + other.size.x) {
+        if (mask & Col_Top && step_velocity->y < 0.0f && body->p.y <= other.p.y + other.size.y &&
+            body->p.y + body->size.y > other.p.y) {
             f32 y_overlap = step_position.y - other.p.y + other.size.y;
             if (y_overlap > SKIN_WIDTH) {
                 if (resolve) {
-                    step_velocity->y = other.p.y - SKIN_WIDTH + other.size.y - rigidbody->p.y;
-                    rigidbody->velocity.y = 0.0f;
-                    if (rigidbody->invert_gravity) {
-                        rigidbody->is_grounded = true;
+                    step_velocity->y = other.p.y - SKIN_WIDTH + other.size.y - body->p.y;
+                    velocity->y = 0.0f;
+                    if (flags->invert_gravity) {
+                        flags->is_grounded = true;
                     }
                 }
                 found = Col_Top;
             }
-        } else if (mask & Col_Bottom && step_velocity->y > 0.0f && rigidbody->p.y + rigidbody->size.y <= other.p.y) {
-            f32 y_overlap = step_position.y - other.p.y + rigidbody->size.y;
+        } else if (mask & Col_Bottom && step_velocity->y > 0.0f && body->p.y + body->size.y <= other.p.y) {
+            f32 y_overlap = step_position.y - other.p.y + body->size.y;
             if (y_overlap > SKIN_WIDTH) {
                 if (resolve) {
-                    step_velocity->y = other.p.y + SKIN_WIDTH - rigidbody->size.y - rigidbody->p.y;
-                    rigidbody->velocity.y = 0.0f;
-                    if (!rigidbody->invert_gravity) {
-                        rigidbody->is_grounded = true;
+                    step_velocity->y = other.p.y + SKIN_WIDTH - body->size.y - body->p.y;
+                    velocity->y = 0.0f;
+                    if (!flags->invert_gravity) {
+                        flags->is_grounded = true;
                     }
                 }
                 found = Col_Bottom;
@@ -88,141 +250,237 @@ ray_box_collision(Ray ray, f32 min_dist, f32 max_dist, BoundingBox box) {
     return false;
 }
 
-bool
+inline bool
+is_tile_solid(Game_State* game, Tile tile) {
+    s32 gid = get_tile_gid(tile);
+    if (gid == 0) return false;
+    if (gid < game->solid_tile_count) {
+        return game->solid_tiles[gid];
+    }
+    return true;
+}
+
+int
 check_tilemap_collision(Game_State* game, Entity* entity, v2* step_velocity) {
-    bool result = false;
-    
-    // TODO(Alexander): this is not super effecient so we shouldn't rely on this
-    v2s screen_p;
-    screen_p.x = (s32) floor(game->camera_p.x);
-    screen_p.y = (s32) floor(game->camera_p.y);
-    
-    Box collider = {};
-    collider.size = vec2(1, 1);
-    for (int y = 0; y < game->tile_map_height; y++) {
-        for (int x = 0; x < game->tile_map_width; x++) {
-            if (x >= screen_p.x && x <= screen_p.x + game->game_width) {
-                u8 tile = game->tile_map[y*game->tile_map_width + x];
-                if (tile == 0) continue;
-                
-                collider.p = vec2((f32) x, (f32) y);
-                
-                bool collided = box_collision(entity, collider, step_velocity, true, Col_All);
-                if (collided) {
-                    result = true;
-                }
-            }
+    Box* collider = get_entity_collider(game, entity);
+    v2* velocity = get_entity_velocity(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    
+    int result = Col_None;
+    
+    // NOTE(Alexander): only visit the tiles covered by the swept collider
+    v2 min_p = collider->p;
+    v2 max_p = collider->p + collider->size;
+    min_p.x += min(step_velocity->x, 0.0f);
+    min_p.y += min(step_velocity->y, 0.0f);
+    max_p.x += max(step_velocity->x, 0.0f);
+    max_p.y += max(step_velocity->y, 0.0f);
+    
+    s32 min_x = max((s32) floorf(min_p.x), 0);
+    s32 min_y = max((s32) floorf(min_p.y), 0);
+    s32 max_x = min((s32) floorf(max_p.x), game->tile_map_width - 1);
+    s32 max_y = min((s32) floorf(max_p.y), game->tile_map_height - 1);
+    
+    Box tile_box = {};
+    tile_box.size = vec2(1, 1);
+    for (s32 y = min_y; y <= max_y; y++) {
+        for (s32 x = min_x; x <= max_x; x++) {
+            Tile tile = game->tile_map[y*game->tile_map_width + x];
+            if (!is_tile_solid(game, tile)) continue;
+            
+            tile_box.p = vec2((f32) x, (f32) y);
+            result |= box_collision(collider, velocity, flags, tile_box, step_velocity, true, Col_All);
         }
     }
     
     return result;
 }
 
+// NOTE(Alexander): greedy merge of solid tiles into as few boxes as possible,
+// first extend a run along the row then grow it downwards while the full run is solid.
+void
+bake_tile_colliders(Game_State* game, Memory_Arena* arena) {
+    int width = game->tile_map_width;
+    int height = game->tile_map_height;
+    bool* used = push_array_of_structs(arena, width*height, bool);
+    
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int tile_index = y*width + x;
+            if (used[tile_index] || !is_tile_solid(game, game->tile_map[tile_index])) continue;
+            
+            int run_width = 1;
+            while (x + run_width < width) {
+                int next_index = tile_index + run_width;
+                if (used[next_index] || !is_tile_solid(game, game->tile_map[next_index])) break;
+                run_width++;
+            }
+            
+            int run_height = 1;
+            for (; y + run_height < height; run_height++) {
+                bool is_row_solid = true;
+                for (int run_x = x; run_x < x + run_width; run_x++) {
+                    int next_index = (y + run_height)*width + run_x;
+                    if (used[next_index] || !is_tile_solid(game, game->tile_map[next_index])) {
+                        is_row_solid = false;
+                        break;
+                    }
+                }
+                if (!is_row_solid) break;
+            }
+            
+            for (int run_y = y; run_y < y + run_height; run_y++) {
+                memset(&used[run_y*width + x], true, run_width);
+            }
+            
+            add_collider(game, vec2((f32) x, (f32) y), vec2((f32) run_width, (f32) run_height));
+        }
+    }
+}
+
 void
 check_collisions(Game_State* game, Entity* entity, v2* step_velocity) {
-    entity->is_grounded = false;
-    entity->collided_with = 0;
+    Box* collider = get_entity_collider(game, entity);
+    v2* velocity = get_entity_velocity(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
+    Entity_Cold* cold = get_entity_cold(game, entity);
+    flags->is_grounded = false;
+    cold->collided_with = 0;
     entity->collision = Col_None;
     entity->map_collision = Col_None;
     
-    for_array(game->colliders, other, col_index) {
-        if (col_index >= game->collider_count) break;
+    // Broadphase, only look at things overlapping the swept collider
+    Box sweep = *collider;
+    sweep.p.x += min(step_velocity->x, 0.0f);
+    sweep.p.y += min(step_velocity->y, 0.0f);
+    sweep.size += abs(*step_velocity);
+    sweep.p -= GRID_MARGIN;
+    sweep.size += 2.0f*GRID_MARGIN;
+    
+    // NOTE(Alexander): the candidate list can't be larger than what is stored in the grid
+    Spatial_Grid* grid = &game->grid;
+    Temp_Memory temp_memory = begin_temporary_memory(&game->frame_arena);
+    s32* candidates = push_frame_array(game, max(game->collider_count, game->entity_count), s32);
+    int candidate_count = query_spatial_grid(grid, grid->static_cells, grid->static_entries, sweep,
+                                             candidates, game->collider_count);
+    for (int candidate_index = 0; candidate_index < candidate_count; candidate_index++) {
+        Box* other = &game->colliders[candidates[candidate_index]];
         
-        Collision collision = box_collision(entity, *other, step_velocity, true, Col_All);
+        Collision collision = box_collision(collider, velocity, flags, *other, step_velocity, true, Col_All);
         if (collision) {
             entity->map_collision = entity->map_collision | collision;
         }
     }
     
-    for_array(game->entities, other, entity_index) {
-        if (entity_index >= game->entity_count) break;
+    // Collision with the tiles
+    if (game->use_tile_collision) {
+        entity->map_collision |= check_tilemap_collision(game, entity, step_velocity);
+    }
+    
+    candidate_count = query_spatial_grid(grid, grid->dynamic_cells, grid->dynamic_entries, sweep,
+                                         candidates, game->entity_count);
+    for (int candidate_index = 0; candidate_index < candidate_count; candidate_index++) {
+        Entity* other = get_entity_by_spawn_id(game, candidates[candidate_index]);
         if (other->type == None) continue;
         
-        if (other != entity && (other->is_rigidbody || other->is_solid || other->is_trigger)) {
-            Box other_collider = other->collider;
+        Entity_Flags* other_flags = get_entity_flags(game, other);
+        if (other != entity && (other_flags->is_rigidbody || other_flags->is_solid || other_flags->is_trigger)) {
+            Box other_collider = *get_entity_collider(game, other);
             other_collider.p += other->offset;
-            Collision mask = other->collision_mask;
+            Collision mask = get_entity_cold(game, other)->collision_mask;
             if (mask == Col_None) {
                 mask = Col_All;
             }
             
-            if (other->is_trigger) {
-                if (box_check(entity->collider, other->collider)) {
-                    entity->collided_with = other;
+            if (other_flags->is_trigger) {
+                if (box_check(*collider, *get_entity_collider(game, other))) {
+                    cold->collided_with = other;
                     entity->collision = Col_All;
                 }
             } else {
-                Collision collision = box_collision(entity, other_collider, step_velocity, !other->is_rigidbody, mask);
+                Collision collision = box_collision(collider, velocity, flags, other_collider, step_velocity, !other_flags->is_rigidbody, mask);
                 if (collision) {
-                    entity->collided_with = other;
+                    cold->collided_with = other;
                     entity->collision = collision;
                 }
             }
         }
     }
     
-    // Collision with the tiles
-    //check_tilemap_collision(game, entity, step_velocity);
+    end_temporary_memory(temp_memory);
 }
 
 void
 update_rigidbody(Game_State* game, Entity* entity) {
-    if (!entity->is_rigidbody) return;
+    Box* collider = get_entity_collider(game, entity);
+    v2* velocity = get_entity_velocity(game, entity);
+    v2* acceleration = get_entity_acceleration(game, entity);
+    Entity_Flags* flags = get_entity_flags(game, entity);
     
-    f32 delta_time = GetFrameTime();
+    if (!flags->is_rigidbody) return;
+    
+    f32 delta_time = game->sim_dt;
     
     // Rigidbody physics
-    v2 step_velocity = entity->velocity * delta_time + entity->acceleration * delta_time * delta_time * 0.5f;
+    v2 step_velocity = *velocity * delta_time + *acceleration * delta_time * delta_time * 0.5f;
     
-    v2 velocity_before = entity->velocity;
+    v2 velocity_before = *velocity;
     check_collisions(game, entity, &step_velocity);
     
-    entity->p += step_velocity;
-    entity->velocity += entity->acceleration * delta_time;
+    collider->p += step_velocity;
+    *velocity += *acceleration * delta_time;
     
     // Play sound effect on player inpact with ground at max speed
-    if (entity->type == Player && entity->prev_invert_gravity != entity->invert_gravity &&
+    if (entity->type == Player && entity->prev_invert_gravity != flags->invert_gravity &&
         fabsf(velocity_before.y) > entity->max_speed.y*0.8f) {
-        if (entity->is_grounded) {
+        if (flags->is_grounded) {
             PlaySound(game->snd_gravity_landing);
+            
+            // Kick up dust away from the surface we landed on
+            Particle_Emitter* dust = game->emitter_landing;
+            dust->min_angle = flags->invert_gravity ? 0.0f : -PI_F32;
+            dust->max_angle = flags->invert_gravity ? PI_F32 : 0.0f;
+            v2 feet = collider->p + vec2(collider->size.x*0.5f, flags->invert_gravity ? 0.0f : collider->size.y);
+            spawn_particle_effect(game->particles, dust, feet, 10);
         }
     }
-    if (entity->is_grounded) {
-        entity->prev_invert_gravity = entity->invert_gravity;
+    if (flags->is_grounded) {
+        entity->prev_invert_gravity = flags->invert_gravity;
     }
     
     
-    if (entity->frames > 0) {
-        entity->frame_advance += step_velocity.x * entity->frame_duration;
+    Entity_Render* render = get_entity_render(game, entity);
+    if (render->frames > 0) {
+        render->frame_advance += step_velocity.x * render->frame_duration;
         if (fabsf(step_velocity.x) <= 0.01f) {
-            entity->frame_advance = 0.0f;
+            render->frame_advance = 0.0f;
         }
         
-        if (entity->frame_advance > entity->frames) {
-            entity->frame_advance -= entity->frames;
+        if (render->frame_advance > render->frames) {
+            render->frame_advance -= render->frames;
         }
         
-        if (entity->frame_advance < 0.0f) {
-            entity->frame_advance += entity->frames;
+        if (render->frame_advance < 0.0f) {
+            render->frame_advance += render->frames;
         }
     }
     
-    if (fabsf(entity->velocity.x) > entity->max_speed.x) {
-        entity->velocity.x = sign(entity->velocity.x) * entity->max_speed.x;
+    if (fabsf(velocity->x) > entity->max_speed.x) {
+        velocity->x = sign(velocity->x) * entity->max_speed.x;
     }
     
-    if (fabsf(entity->velocity.y) > entity->max_speed.y) {
-        entity->velocity.y = sign(entity->velocity.y) * entity->max_speed.y;
+    if (fabsf(velocity->y) > entity->max_speed.y) {
+        velocity->y = sign(velocity->y) * entity->max_speed.y;
     }
     
-    if (!game->is_moon_gravity || entity->is_grounded) {
-        if (fabsf(entity->acceleration.x) > epsilon32 && fabsf(entity->velocity.x) > epsilon32 &&
-            sign(entity->acceleration.x) != sign(entity->velocity.x)) {
-            entity->acceleration.x *= 2.0f;
+    if (!game->is_moon_gravity || flags->is_grounded) {
+        if (fabsf(acceleration->x) > epsilon32 && fabsf(velocity->x) > epsilon32 &&
+            sign(acceleration->x) != sign(velocity->x)) {
+            acceleration->x *= 2.0f;
         }
         
-        if (fabsf(entity->acceleration.x) < epsilon32) {
-            entity->velocity.x *= 0.8f;
+        if (fabsf(acceleration->x) < epsilon32) {
+            velocity->x *= 0.8f;
         }
     }
 }
\ No newline at end of file
@@ -1,123 +1,200 @@
+// NOTE(Alexander): scanners are bounded by an end pointer, the source is not required to be
+// null terminated so it can be scanned straight out of a memory mapped file.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+inline u32
+count_trailing_zeros(u32 value) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return (u32) index;
+#else
+    return (u32) __builtin_ctz(value);
+#endif
+}
+
+inline u8*
+find_byte_scalar(u8* scan, u8* end, u8 c) {
+    while (scan < end && *scan != c) {
+        scan++;
+    }
+    return scan;
+}
+
+// NOTE(Alexander): returns the first occurrence of c, or end if there is none. Compares 32
+// or 16 bytes at a time and finishes the tail one byte at a time.
+u8*
+find_byte(u8* scan, u8* end, u8 c) {
+#if defined(__AVX2__)
+    __m256i needle32 = _mm256_set1_epi8((char) c);
+    for (; end - scan >= 32; scan += 32) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*) scan);
+        u32 mask = (u32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle32));
+        if (mask) {
+            return scan + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    
+#if USE_SSE2
+    __m128i needle = _mm_set1_epi8((char) c);
+    for (; end - scan >= 16; scan += 16) {
+        __m128i chunk = _mm_loadu_si128((__m128i*) scan);
+        u32 mask = (u32) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask) {
+            return scan + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    
+    return find_byte_scalar(scan, end, c);
+}
+
+// Same as find_byte but stops at either a or b
+u8*
+find_byte2(u8* scan, u8* end, u8 a, u8 b) {
+#if defined(__AVX2__)
+    __m256i needle_a32 = _mm256_set1_epi8((char) a);
+    __m256i needle_b32 = _mm256_set1_epi8((char) b);
+    for (; end - scan >= 32; scan += 32) {
+        __m256i chunk = _mm256_loadu_si256((__m256i*) scan);
+        __m256i match = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, needle_a32), _mm256_cmpeq_epi8(chunk, needle_b32));
+        u32 mask = (u32) _mm256_movemask_epi8(match);
+        if (mask) {
+            return scan + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    
+#if USE_SSE2
+    __m128i needle_a = _mm_set1_epi8((char) a);
+    __m128i needle_b = _mm_set1_epi8((char) b);
+    for (; end - scan >= 16; scan += 16) {
+        __m128i chunk = _mm_loadu_si128((__m128i*) scan);
+        __m128i match = _mm_or_si128(_mm_cmpeq_epi8(chunk, needle_a), _mm_cmpeq_epi8(chunk, needle_b));
+        u32 mask = (u32) _mm_movemask_epi8(match);
+        if (mask) {
+            return scan + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    
+    for (; scan < end; scan++) {
+        if (*scan == a || *scan == b) {
+            break;
+        }
+    }
+    return scan;
+}
 int
-eat_string(u8** scanner, cstring pattern) {
-    int count = 0;
+eat_string(u8** scanner, u8* end, cstring pattern) {
     u8* scan = *scanner;
     u8* pattern_scan = (u8*) pattern;
     while (*pattern_scan) {
-        count++;
-        if (*scan++ != *pattern_scan++) {
+        if (scan >= end || *scan++ != *pattern_scan++) {
             return false;
         }
     }
-    string result;
-    result.data = (u8*) *scanner;
-    result.count = count;
     
     *scanner = scan;
     return true;
 }
 
 string
-eat_until(u8** scanner, u8 end) {
+eat_until(u8** scanner, u8* end, u8 delimiter) {
     string result;
     result.data = (u8*) *scanner;
+    result.count = 0;
     
-    u32 count = 0;
-    u8* scan = *scanner;
-    while (*scan) {
-        if (*scan++ == end) {
-            *scanner = scan;
-            result.count = count;
-            break;
-        }
-        count++;
+    u8* found = find_byte(*scanner, end, delimiter);
+    if (found < end) {
+        result.count = found - *scanner;
+        *scanner = found + 1;
     }
     
     return result;
 }
 
 string
-eat_until_excluding_end(u8** scanner, u8 end) {
+eat_until_excluding_end(u8** scanner, u8* end, u8 delimiter) {
     string result;
     result.data = (u8*) *scanner;
+    result.count = 0;
     
-    u32 count = 0;
-    u8* scan = *scanner;
-    while (*scan) {
-        if (*scan == end) {
-            *scanner = scan;
-            result.count = count;
-            break;
-        }
-        scan++;
-        count++;
+    u8* found = find_byte(*scanner, end, delimiter);
+    if (found < end) {
+        result.count = found - *scanner;
+        *scanner = found;
     }
     
     return result;
 }
 
 inline string
-eat_line(u8** scanner) {
-    return eat_until(scanner, '\n');
+eat_line(u8** scanner, u8* end) {
+    return eat_until(scanner, end, '\n');
 }
 
-// TODO(Alexander): WIP
-#if 0
 f32
-eat_f32(char** scanner) {
-    u8* scan = (u8*) *scanner;
-    u32 curr_index = 0;
+eat_f32(u8** scanner, u8* end) {
+    u8* scan = *scanner;
+    f64 sign = 1.0;
+    if (scan < end && (*scan == '-' || *scan == '+')) {
+        if (*scan == '-') sign = -1.0;
+        scan++;
+    }
+    
     f64 value = 0.0;
-    u8 c = 0;
-    while (curr_index < token.suffix_start) {
-        c = token.source[curr_index++];
-        if (c == '_') continue;
-        if (c == 'e' || c == 'E' || c == '.') break;
-        f64 d = (f64) hex_digit_to_s32(c);
-        value = value * 10.0 + d;
+    for (; scan < end && *scan >= '0' && *scan <= '9'; scan++) {
+        value = value*10.0 + (f64) (*scan - '0');
     }
     
-    if (c == '.') {
+    if (scan < end && *scan == '.') {
+        scan++;
         f64 numerator = 0.0;
         f64 denominator = 1.0;
-        while (curr_index < string_count(token.source)) {
-            c = token.source[curr_index++];
-            if (c == '_') continue;
-            if (c == 'e' || c == 'E') break;
-            numerator = numerator * 10.0 + (f64) (c - '0');
-            denominator = denominator * 10.0;
+        for (; scan < end && *scan >= '0' && *scan <= '9'; scan++) {
+            numerator = numerator*10.0 + (f64) (*scan - '0');
+            denominator = denominator*10.0;
         }
         value += numerator/denominator;
     }
     
-    if (c == 'e' || c == 'E') {
-        pln("token.source = %\n", f_string(token.source));
-        c = token.source[curr_index++];
+    if (scan < end && (*scan == 'e' || *scan == 'E')) {
+        scan++;
         f64 exponent = 0.0;
-        f64 sign = 1.0;
-        if (c == '-') sign = -1.0;
-        
-        while (curr_index < string_count(token.source)) {
-            c = token.source[curr_index++];
-            if (c == '_') continue;
-            exponent = exponent * 10.0 + (f64) (c - '0');
+        f64 exponent_sign = 1.0;
+        if (scan < end && (*scan == '-' || *scan == '+')) {
+            if (*scan == '-') exponent_sign = -1.0;
+            scan++;
+        }
+        for (; scan < end && *scan >= '0' && *scan <= '9'; scan++) {
+            exponent = exponent*10.0 + (f64) (*scan - '0');
         }
-        value = value*pow(10.0, sign*exponent);
+        value = value*pow(10.0, exponent_sign*exponent);
     }
+    
+    *scanner = scan;
+    return (f32) (sign*value);
 }
-#endif
 
 int
-eat_integer(u8** scanner) {
+eat_integer(u8** scanner, u8* end) {
     int result = 0;
     bool negative = false;
     u8* scan = *scanner;
-    if (*scan == '-') {
+    if (scan < end && *scan == '-') {
         negative = true;
         scan++;
     }
     
-    for (; *scan; scan++) {
+    for (; scan < end; scan++) {
         if (*scan < '0' || *scan > '9') {
             break;
         }
@@ -132,3 +209,201 @@ eat_integer(u8** scanner) {
     
     return result;
 }
+
+u32
+eat_u32(u8** scanner, u8* end) {
+    u32 result = 0;
+    u8* scan = *scanner;
+    for (; scan < end && *scan >= '0' && *scan <= '9'; scan++) {
+        result = result*10 + (u32) (*scan - '0');
+    }
+    *scanner = scan;
+    return result;
+}
+
+inline int
+string_to_integer(string str) {
+    u8* scan = str.data;
+    return eat_integer(&scan, str.data + str.count);
+}
+
+inline u32
+string_to_u32(string str) {
+    u8* scan = str.data;
+    return eat_u32(&scan, str.data + str.count);
+}
+
+inline f32
+string_to_f32(string str) {
+    u8* scan = str.data;
+    return eat_f32(&scan, str.data + str.count);
+}
+
+inline bool
+is_xml_whitespace(u8 c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+// NOTE(Alexander): decodes base64 text up to end, whitespace and '=' padding are skipped.
+// Returns the number of bytes written to dest, or -1 for invalid text or if dest is too small.
+smm
+eat_base64(u8** scanner, u8* end, u8* dest, umm dest_size) {
+    static s8 table[256];
+    static bool is_initialized = false;
+    if (!is_initialized) {
+        memset(table, -1, sizeof(table));
+        for (int index = 0; index < 26; index++) {
+            table['A' + index] = (s8) index;
+            table['a' + index] = (s8) (26 + index);
+        }
+        for (int index = 0; index < 10; index++) {
+            table['0' + index] = (s8) (52 + index);
+        }
+        table['+'] = 62;
+        table['/'] = 63;
+        is_initialized = true;
+    }
+    
+    u8* scan = *scanner;
+    umm used = 0;
+    u32 bits = 0;
+    s32 bit_count = 0;
+    while (scan < end) {
+        // NOTE(Alexander): Tiled writes the data on one line, so most of it is decoded
+        // four characters to three bytes at a time.
+        if (bit_count == 0) {
+            while (end - scan >= 4 && dest_size - used >= 3) {
+                s32 a = table[scan[0]];
+                s32 b = table[scan[1]];
+                s32 c = table[scan[2]];
+                s32 d = table[scan[3]];
+                if ((a | b | c | d) < 0) break;
+                
+                u32 value = (a << 18) | (b << 12) | (c << 6) | d;
+                dest[used] = (u8) (value >> 16);
+                dest[used + 1] = (u8) (value >> 8);
+                dest[used + 2] = (u8) value;
+                used += 3;
+                scan += 4;
+            }
+            if (scan >= end) break;
+        }
+        
+        u8 character = *scan++;
+        if (is_xml_whitespace(character) || character == '=') {
+            continue;
+        }
+        
+        s32 value = table[character];
+        if (value < 0) {
+            *scanner = scan - 1;
+            return -1;
+        }
+        
+        bits = (bits << 6) | value;
+        bit_count += 6;
+        if (bit_count >= 8) {
+            bit_count -= 8;
+            if (used >= dest_size) {
+                *scanner = scan;
+                return -1;
+            }
+            dest[used++] = (u8) (bits >> bit_count);
+        }
+    }
+    
+    *scanner = scan;
+    return (smm) used;
+}
+
+// NOTE(Alexander): call right after the '<' of a tag, returns the tag name e.g. "object" or
+// "/objectgroup" for closing tags and leaves the scanner at the first attribute.
+string
+eat_xml_tag_name(u8** scanner, u8* end) {
+    string result;
+    result.data = *scanner;
+    
+    u8* scan = *scanner;
+    while (scan < end && !is_xml_whitespace(*scan) && *scan != '>' && *scan != '/') {
+        scan++;
+    }
+    if (scan == result.data && scan < end && *scan == '/') {
+        // closing tag, keep the slash as part of the name
+        scan++;
+        while (scan < end && !is_xml_whitespace(*scan) && *scan != '>') {
+            scan++;
+        }
+    }
+    
+    result.count = scan - result.data;
+    *scanner = scan;
+    return result;
+}
+
+struct Xml_Attribute {
+    string name;
+    string value;
+    
+    // Set once the end of the tag is reached, true for tags closed with "/>"
+    bool is_empty_tag;
+};
+
+// NOTE(Alexander): reads the next name="value" pair of the current tag, every byte is read
+// once. Returns false at the end of the tag with the scanner just past the '>'.
+bool
+eat_xml_attribute(u8** scanner, u8* end, Xml_Attribute* attribute) {
+    bool is_after_slash = false;
+    u8* scan = *scanner;
+    while (scan < end) {
+        while (scan < end && is_xml_whitespace(*scan)) {
+            scan++;
+        }
+        if (scan >= end) {
+            break;
+        }
+        
+        if (*scan == '>') {
+            attribute->is_empty_tag = is_after_slash;
+            *scanner = scan + 1;
+            return false;
+        }
+        if (*scan == '/' || *scan == '?') {
+            is_after_slash = *scan == '/';
+            scan++;
+            continue;
+        }
+        is_after_slash = false;
+        
+        attribute->name.data = scan;
+        while (scan < end && *scan != '=' && *scan != '>' && !is_xml_whitespace(*scan)) {
+            scan++;
+        }
+        attribute->name.count = scan - attribute->name.data;
+        
+        while (scan < end && is_xml_whitespace(*scan)) {
+            scan++;
+        }
+        if (scan >= end || *scan != '=') {
+            // attribute without a value, not valid xml but skip over it
+            continue;
+        }
+        scan++;
+        
+        while (scan < end && is_xml_whitespace(*scan)) {
+            scan++;
+        }
+        if (scan >= end || (*scan != '"' && *scan != '\'')) {
+            continue;
+        }
+        
+        u8 quote = *scan++;
+        u8* value_end = find_byte(scan, end, quote);
+        attribute->value.data = scan;
+        attribute->value.count = value_end - scan;
+        *scanner = value_end < end ? value_end + 1 : end;
+        return true;
+    }
+    
+    *scanner = end;
+    return false;
+}
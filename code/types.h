@@ -2,6 +2,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdarg.h>
+
+// NOTE(Alexander): SSE2 is always there on x64, other targets use the scalar paths
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#define USE_SSE2 1
+#include <emmintrin.h>
+#else
+#define USE_SSE2 0
+#endif
 
 #define PI_F32 3.1415926535897932385f
 
@@ -11,7 +20,7 @@
 #define clamp(value, min, max) ((value) < (min) ? (min) : ((value) > (max) ? (max) : (value)))
 
 #if BUILD_DEBUG
-#define pln(format, ...) printf(format##"\n", __VA_ARGS__)
+#define pln(format, ...) printf(format "\n", ##__VA_ARGS__)
 #else
 #define pln(format, ...)
 #endif